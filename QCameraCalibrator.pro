@@ -11,25 +11,70 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-    calibrationthread.cpp \
-    camerathread.cpp \
+    calibrationtask.cpp \
+    cameraframe.cpp \
+    camerapipeline.cpp \
+    camerastage.cpp \
+    captureservice.cpp \
+    charucocalibrator.cpp \
+    configurationcompactor.cpp \
+    configurationindex.cpp \
+    configurationmodel.cpp \
+    configurationrepository.cpp \
+    configurationstore.cpp \
     configurationswidget.cpp \
+    detectionpipeline.cpp \
+    detectorsettingswidget.cpp \
+    displayframepool.cpp \
+    frameitem.cpp \
+    framemailbox.cpp \
+    fusedmarkerdetector.cpp \
     graphicsviewcontainer.cpp \
+    ioworker.cpp \
+    latencymetrics.cpp \
     main.cpp \
     mainwindow.cpp \
-    markerthread.cpp \
-    section.cpp \
+    markerdetector.cpp \
+    markerstage.cpp \
+    metricswidget.cpp \
+    taskexecutor.cpp \
+    trackingstream.cpp \
+    videosource.cpp \
     workspace.cpp \
     yamlhandler.cpp
 
 HEADERS += \
-    calibrationthread.h \
-    camerathread.h \
+    calibrationtask.h \
+    cameraframe.h \
+    camerapipeline.h \
+    camerastage.h \
+    captureservice.h \
+    charucocalibrator.h \
+    configurationcompactor.h \
+    configurationindex.h \
+    configurationmodel.h \
+    configurationrepository.h \
+    configurationstore.h \
     configurationswidget.h \
+    detectionpipeline.h \
+    detectorsettingswidget.h \
+    displayframepool.h \
+    frameitem.h \
+    framemailbox.h \
+    frameoverlay.h \
+    framestage.h \
+    fusedmarkerdetector.h \
     graphicsviewcontainer.h \
+    ioworker.h \
+    latencymetrics.h \
+    lockfreequeue.h \
     mainwindow.h \
-    markerthread.h \
-    section.h \
+    markerdetector.h \
+    markerstage.h \
+    metricswidget.h \
+    taskexecutor.h \
+    trackingstream.h \
+    videosource.h \
     workspace.h \
     yamlhandler.h
 
@@ -43,6 +88,10 @@ else:unix: LIBS += -L$$PWD/third_party/opencv_mingw810/x64/mingw/lib/ -llibopenc
 INCLUDEPATH += $$PWD/third_party/opencv_mingw810/include
 DEPENDPATH += $$PWD/third_party/opencv_mingw810/include
 
+# Synthetic benchmark, see bench/main.cpp
+bench.commands = $$sprintf($$QMAKE_MKDIR_CMD, bench) && cd bench && $$QMAKE_QMAKE $$shell_quote($$PWD/bench/bench.pro) && $(MAKE) && $$shell_path(./bench)
+QMAKE_EXTRA_TARGETS += bench
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
@@ -0,0 +1,44 @@
+TEMPLATE = app
+TARGET = bench
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle debug_and_release
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    main.cpp \
+    scenegenerator.cpp \
+    ../cameraframe.cpp \
+    ../charucocalibrator.cpp \
+    ../configurationindex.cpp \
+    ../configurationstore.cpp \
+    ../detectionpipeline.cpp \
+    ../fusedmarkerdetector.cpp \
+    ../latencymetrics.cpp \
+    ../markerdetector.cpp \
+    ../taskexecutor.cpp \
+    ../yamlhandler.cpp
+
+HEADERS += \
+    scenegenerator.h \
+    ../cameraframe.h \
+    ../charucocalibrator.h \
+    ../configurationindex.h \
+    ../configurationstore.h \
+    ../detectionpipeline.h \
+    ../fusedmarkerdetector.h \
+    ../latencymetrics.h \
+    ../markerdetector.h \
+    ../taskexecutor.h \
+    ../yamlhandler.h
+
+# OPENCV
+win32: LIBS += -L$$PWD/../third_party/opencv_mingw810/x64/mingw/bin/ -llibopencv_world4100
+else:unix: LIBS += -L$$PWD/../third_party/opencv_mingw810/x64/mingw/lib/ -llibopencv_world4100
+
+INCLUDEPATH += $$PWD/../third_party/opencv_mingw810/include
+DEPENDPATH += $$PWD/../third_party/opencv_mingw810/include
@@ -0,0 +1,742 @@
+#include "cameraframe.h"
+#include "charucocalibrator.h"
+#include "configurationindex.h"
+#include "configurationstore.h"
+#include "detectionpipeline.h"
+#include "fusedmarkerdetector.h"
+#include "latencymetrics.h"
+#include "markerdetector.h"
+#include "scenegenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+static const float MARKER_SIZE = 55.0f;
+// Tiled corners may differ from whole-frame ones by float rounding only
+static const double TILE_CORNER_TOLERANCE = 0.01;
+
+struct BenchOptions
+{
+    int iterations = 100;
+    int calibrationViews = 15;
+    bool quick = false;
+    // Only run the exactness checks, fail on any difference
+    bool verify = false;
+};
+
+static QJsonObject percentiles(std::vector<double> samples)
+{
+    QJsonObject result;
+    if (samples.empty())
+        return result;
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double p) {
+        return samples[std::min(samples.size() - 1, (size_t) (p * samples.size()))];
+    };
+    result["p50"] = at(0.50);
+    result["p95"] = at(0.95);
+    result["p99"] = at(0.99);
+    result["max"] = samples.back();
+    return result;
+}
+
+static qint64 peakRssKb()
+{
+#ifdef Q_OS_LINUX
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&status);
+        QString line;
+        while (in.readLineInto(&line)) {
+            if (line.startsWith("VmHWM:"))
+                return line.section(' ', 1, -1, QString::SectionSkipEmpty).section(' ', 0, 0).toLongLong();
+        }
+    }
+#endif
+    return -1;
+}
+
+static double rotationErrorDegrees(const cv::Vec3d &estimated, const cv::Vec3d &truth)
+{
+    cv::Matx33d estimatedRotation, trueRotation;
+    cv::Rodrigues(estimated, estimatedRotation);
+    cv::Rodrigues(truth, trueRotation);
+    cv::Matx33d difference = estimatedRotation.t() * trueRotation;
+    double cosine = (cv::trace(difference) - 1.0) / 2.0;
+    return std::acos(std::max(-1.0, std::min(1.0, cosine))) * 180.0 / CV_PI;
+}
+
+static QJsonObject sceneJson(const SceneSettings &settings)
+{
+    QJsonObject scene;
+    scene["resolution"] = QString("%1x%2").arg(settings.resolution.width).arg(
+        settings.resolution.height);
+    scene["markers"] = settings.markerCount;
+    scene["blur"] = settings.blurSigma;
+    scene["noise"] = settings.noiseSigma;
+    scene["angle"] = settings.angle;
+    return scene;
+}
+
+// Same detect and pose path as MarkerStage, on frames with known poses
+static QJsonObject runMarkerBench(
+    const SceneSettings &settings, const BenchOptions &options, SceneGenerator &generator)
+{
+    MarkerDetector detector;
+    CalibrationParams params;
+    params.cameraMatrix = SceneGenerator::cameraMatrixFor(settings.resolution);
+    params.distCoeffs = cv::Mat::zeros(1, 5, CV_64F);
+    detector.setCalibrationParams(params);
+    detector.setMarkerSize(MARKER_SIZE);
+
+    // Rendering stays out of the timed loop, a few scenes are cycled instead
+    std::vector<MarkerScene> scenes;
+    for (int i = 0; i < 4; i++) {
+        scenes.push_back(generator.renderMarkers(settings));
+    }
+
+    std::vector<double> detectLatencies, poseLatencies, totalLatencies;
+    size_t expected = 0, found = 0;
+    double translationError = 0.0, rotationError = 0.0;
+
+    qint64 begin = LatencyMetrics::now();
+    for (int i = 0; i < options.iterations; i++) {
+        const MarkerScene &scene = scenes[i % scenes.size()];
+        MarkerDetections detections;
+
+        qint64 start = LatencyMetrics::now();
+        detector.detect(scene.image, detections);
+        qint64 detected = LatencyMetrics::now();
+        detector.estimatePoses(detections);
+        qint64 end = LatencyMetrics::now();
+
+        detectLatencies.push_back((detected - start) / 1e6);
+        poseLatencies.push_back((end - detected) / 1e6);
+        totalLatencies.push_back((end - start) / 1e6);
+
+        expected += scene.markers.size();
+        for (const MarkerGroundTruth &truth : scene.markers) {
+            auto it = std::find(detections.markerIds.begin(), detections.markerIds.end(), truth.id);
+            if (it == detections.markerIds.end())
+                continue;
+            size_t index = std::distance(detections.markerIds.begin(), it);
+            found++;
+            translationError += cv::norm(detections.tvecs[index] - truth.tvec);
+            rotationError += rotationErrorDegrees(detections.rvecs[index], truth.rvec);
+        }
+    }
+    double elapsed = (LatencyMetrics::now() - begin) / 1e9;
+
+    QJsonObject result;
+    result["bench"] = "markers";
+    result["scene"] = sceneJson(settings);
+    result["iterations"] = options.iterations;
+    result["fps"] = options.iterations / elapsed;
+    result["detect_ms"] = percentiles(detectLatencies);
+    result["pnp_ms"] = percentiles(poseLatencies);
+    result["latency_ms"] = percentiles(totalLatencies);
+    result["detection_rate"] = expected ? (double) found / expected : 0.0;
+    result["translation_error_mm"] = found ? translationError / found : 0.0;
+    result["rotation_error_deg"] = found ? rotationError / found : 0.0;
+    result["peak_rss_kb"] = peakRssKb();
+    return result;
+}
+
+// Frame-parallel detection as in MarkerStage, frames arrive faster than they
+// are detected. Latency is from submit to the frame leaving in order.
+static QJsonObject runPipelineBench(
+    const SceneSettings &settings,
+    int workers,
+    const BenchOptions &options,
+    SceneGenerator &generator)
+{
+    DetectionPipeline pipeline;
+    CalibrationParams params;
+    params.cameraMatrix = SceneGenerator::cameraMatrixFor(settings.resolution);
+    params.distCoeffs = cv::Mat::zeros(1, 5, CV_64F);
+    pipeline.setWorkers(workers);
+    pipeline.setCalibrationParams(params);
+    pipeline.setMarkerSize(MARKER_SIZE);
+
+    // MarkerStage detects on the luma plane of the camera frame
+    std::vector<cv::Mat> images;
+    for (int i = 0; i < 4; i++) {
+        cv::Mat grey;
+        cv::cvtColor(generator.renderMarkers(settings).image, grey, cv::COLOR_BGR2GRAY);
+        images.push_back(grey);
+    }
+
+    std::vector<double> latencies;
+    quint64 expectedSequence = 0;
+    bool ordered = true;
+    auto collect = [&](const DetectionJob &job) {
+        latencies.push_back((LatencyMetrics::now() - job.captureTime) / 1e6);
+        ordered = ordered && job.sequence == expectedSequence++;
+    };
+
+    DetectionJob job;
+    qint64 begin = LatencyMetrics::now();
+    for (int i = 0; i < options.iterations; i++) {
+        pipeline.submit(images[i % images.size()], LatencyMetrics::now());
+        while (pipeline.takeFinished(job)) {
+            collect(job);
+        }
+    }
+    while (pipeline.waitFinished(job)) {
+        collect(job);
+    }
+    double elapsed = (LatencyMetrics::now() - begin) / 1e9;
+
+    QJsonObject result;
+    result["bench"] = "pipeline";
+    result["scene"] = sceneJson(settings);
+    result["workers"] = pipeline.workers();
+    result["iterations"] = options.iterations;
+    result["fps"] = options.iterations / elapsed;
+    result["latency_ms"] = percentiles(latencies);
+    result["in_order"] = ordered;
+    result["peak_rss_kb"] = peakRssKb();
+    return result;
+}
+
+// Every reference marker has to be found once, cornerDifference is raised to
+// the largest corner distance between the two
+static bool sameMarkers(
+    const MarkerDetections &reference, const MarkerDetections &other, double &cornerDifference)
+{
+    bool matches = other.markerIds.size() == reference.markerIds.size();
+    for (size_t j = 0; j < reference.markerIds.size(); j++) {
+        auto it = std::find(other.markerIds.begin(), other.markerIds.end(), reference.markerIds[j]);
+        if (it == other.markerIds.end()) {
+            matches = false;
+            continue;
+        }
+        const std::vector<cv::Point2f> &corners
+            = other.markerCorners[std::distance(other.markerIds.begin(), it)];
+        for (size_t k = 0; k < corners.size(); k++) {
+            cornerDifference = std::max(
+                cornerDifference, cv::norm(corners[k] - reference.markerCorners[j][k]));
+        }
+    }
+    return matches;
+}
+
+// Fused threshold detector against the OpenCV one. Every threshold image is
+// compared with cv::adaptiveThreshold() pixel by pixel.
+static QJsonObject runFusedBench(
+    const SceneSettings &settings,
+    const BenchOptions &options,
+    SceneGenerator &generator,
+    bool &exact)
+{
+    std::vector<MarkerScene> scenes;
+    for (int i = 0; i < 4; i++) {
+        scenes.push_back(generator.renderMarkers(settings));
+    }
+
+    DetectorSettings stockSettings;
+    DetectorSettings fusedSettings;
+    fusedSettings.useFusedThreshold = true;
+    cv::aruco::DetectorParameters params = fusedSettings.toDetectorParameters();
+    FusedMarkerDetector fused(
+        cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250), params);
+
+    qint64 thresholdMismatches = 0;
+    for (const MarkerScene &scene : scenes) {
+        cv::Mat grey;
+        cv::cvtColor(scene.image, grey, cv::COLOR_BGR2GRAY);
+        std::vector<cv::Mat> thresholds;
+        fused.threshold(grey, thresholds);
+        std::vector<int> sizes = fused.windowSizes();
+        for (size_t i = 0; i < sizes.size(); i++) {
+            cv::Mat reference;
+            cv::adaptiveThreshold(
+                grey,
+                reference,
+                255,
+                cv::ADAPTIVE_THRESH_MEAN_C,
+                cv::THRESH_BINARY_INV,
+                sizes[i],
+                params.adaptiveThreshConstant);
+            thresholdMismatches += cv::countNonZero(reference != thresholds[i]);
+        }
+    }
+
+    MarkerDetector stockDetector;
+    stockDetector.setDetectorSettings(stockSettings);
+    MarkerDetector fusedDetector;
+    fusedDetector.setDetectorSettings(fusedSettings);
+
+    bool matches = true;
+    double cornerDifference = 0.0;
+    for (const MarkerScene &scene : scenes) {
+        MarkerDetections stock, detected;
+        stockDetector.detect(scene.image, stock);
+        fusedDetector.detect(scene.image, detected);
+        matches = sameMarkers(stock, detected, cornerDifference) && matches;
+    }
+    exact = thresholdMismatches == 0 && matches && cornerDifference == 0.0;
+
+    QJsonObject result;
+    result["bench"] = "fused_threshold";
+    result["scene"] = sceneJson(settings);
+    result["threshold_mismatches"] = thresholdMismatches;
+    result["matches_opencv"] = matches;
+    result["max_corner_difference_px"] = cornerDifference;
+    if (!options.verify) {
+        auto measure = [&](MarkerDetector &detector, std::vector<double> &latencies) {
+            MarkerDetections detections;
+            for (int i = 0; i < options.iterations; i++) {
+                qint64 start = LatencyMetrics::now();
+                detector.detect(scenes[i % scenes.size()].image, detections);
+                latencies.push_back((LatencyMetrics::now() - start) / 1e6);
+            }
+        };
+        std::vector<double> stockLatencies, fusedLatencies;
+        measure(stockDetector, stockLatencies);
+        measure(fusedDetector, fusedLatencies);
+        result["iterations"] = options.iterations;
+        result["opencv_detect_ms"] = percentiles(stockLatencies);
+        result["fused_detect_ms"] = percentiles(fusedLatencies);
+    }
+    result["peak_rss_kb"] = peakRssKb();
+    return result;
+}
+
+// Tiled against whole-frame detection of the same frames. Tiles are sized
+// from the largest marker the whole-frame detector finds in the scenes.
+static QJsonObject runTileBench(
+    const SceneSettings &settings,
+    const BenchOptions &options,
+    SceneGenerator &generator,
+    bool &exact)
+{
+    std::vector<MarkerScene> scenes;
+    for (int i = 0; i < 4; i++) {
+        scenes.push_back(generator.renderMarkers(settings));
+    }
+
+    MarkerDetector wholeDetector;
+    std::vector<MarkerDetections> wholeDetections(scenes.size());
+    double largestSide = 0.0;
+    for (size_t i = 0; i < scenes.size(); i++) {
+        wholeDetector.detect(scenes[i].image, wholeDetections[i]);
+        for (const std::vector<cv::Point2f> &corners : wholeDetections[i].markerCorners) {
+            largestSide = std::max(largestSide, cv::arcLength(corners, true) / 4.0);
+        }
+    }
+
+    MarkerDetector tiledDetector;
+    DetectorSettings tiledSettings;
+    tiledSettings.tileMarkerSize = (int) std::ceil(largestSide * 1.2);
+    tiledDetector.setDetectorSettings(tiledSettings);
+
+    bool matches = true;
+    double cornerDifference = 0.0;
+    for (size_t i = 0; i < scenes.size(); i++) {
+        MarkerDetections tiled;
+        tiledDetector.detect(scenes[i].image, tiled);
+        matches = sameMarkers(wholeDetections[i], tiled, cornerDifference) && matches;
+    }
+    exact = matches && cornerDifference <= TILE_CORNER_TOLERANCE;
+
+    QJsonObject result;
+    result["bench"] = "tiles";
+    result["scene"] = sceneJson(settings);
+    result["threads"] = TaskExecutor::instance().threadCount();
+    result["tile_marker_size"] = tiledSettings.tileMarkerSize;
+    result["matches_whole_frame"] = matches;
+    result["max_corner_difference_px"] = cornerDifference;
+    if (!options.verify) {
+        auto measure = [&](MarkerDetector &detector, std::vector<double> &latencies) {
+            MarkerDetections detections;
+            qint64 begin = LatencyMetrics::now();
+            for (int i = 0; i < options.iterations; i++) {
+                qint64 start = LatencyMetrics::now();
+                detector.detect(scenes[i % scenes.size()].image, detections);
+                latencies.push_back((LatencyMetrics::now() - start) / 1e6);
+            }
+            return options.iterations / ((LatencyMetrics::now() - begin) / 1e9);
+        };
+        std::vector<double> wholeLatencies, tiledLatencies;
+        double wholeFps = measure(wholeDetector, wholeLatencies);
+        double tiledFps = measure(tiledDetector, tiledLatencies);
+        result["iterations"] = options.iterations;
+        result["whole_detect_ms"] = percentiles(wholeLatencies);
+        result["tiled_detect_ms"] = percentiles(tiledLatencies);
+        result["speedup"] = wholeFps > 0.0 ? tiledFps / wholeFps : 0.0;
+    }
+    result["peak_rss_kb"] = peakRssKb();
+    return result;
+}
+
+// Sharpness and detection of frames with horizontal motion blur, the metric
+// should drop well before detection and poses fall apart
+static QJsonObject runSharpnessBench(
+    const SceneSettings &settings,
+    int blurLength,
+    const BenchOptions &options,
+    SceneGenerator &generator)
+{
+    MarkerDetector detector;
+    CalibrationParams params;
+    params.cameraMatrix = SceneGenerator::cameraMatrixFor(settings.resolution);
+    params.distCoeffs = cv::Mat::zeros(1, 5, CV_64F);
+    detector.setCalibrationParams(params);
+    detector.setMarkerSize(MARKER_SIZE);
+
+    std::vector<MarkerScene> scenes;
+    for (int i = 0; i < 4; i++) {
+        scenes.push_back(generator.renderMarkers(settings));
+        if (blurLength > 1) {
+            cv::Mat kernel = cv::Mat::ones(1, blurLength, CV_32F) / blurLength;
+            cv::filter2D(scenes.back().image, scenes.back().image, -1, kernel);
+        }
+    }
+
+    std::vector<double> measureLatencies;
+    double sharpness = 0.0;
+    size_t expected = 0, found = 0;
+    double translationError = 0.0;
+    for (int i = 0; i < options.iterations; i++) {
+        const MarkerScene &scene = scenes[i % scenes.size()];
+        CameraFrame frame(scene.image, scene.image.size(), scene.image.size());
+
+        qint64 start = LatencyMetrics::now();
+        frame.measureSharpness();
+        measureLatencies.push_back((LatencyMetrics::now() - start) / 1e6);
+        sharpness += frame.sharpness();
+
+        MarkerDetections detections;
+        detector.detect(frame.luma(), detections);
+        if (!detections.markerIds.empty())
+            detector.estimatePoses(detections);
+        expected += scene.markers.size();
+        for (const MarkerGroundTruth &truth : scene.markers) {
+            auto it = std::find(detections.markerIds.begin(), detections.markerIds.end(), truth.id);
+            if (it == detections.markerIds.end())
+                continue;
+            found++;
+            translationError += cv::norm(
+                detections.tvecs[std::distance(detections.markerIds.begin(), it)] - truth.tvec);
+        }
+    }
+
+    QJsonObject result;
+    result["bench"] = "sharpness";
+    result["scene"] = sceneJson(settings);
+    result["motion_blur_px"] = blurLength;
+    result["iterations"] = options.iterations;
+    result["sharpness"] = sharpness / options.iterations;
+    result["measure_ms"] = percentiles(measureLatencies);
+    result["detection_rate"] = expected ? (double) found / expected : 0.0;
+    result["translation_error_mm"] = found ? translationError / found : 0.0;
+    result["peak_rss_kb"] = peakRssKb();
+    return result;
+}
+
+// Same detect and solve path as CalibrationTask, against the true intrinsics
+static QJsonObject runCalibrationBench(
+    const SceneSettings &settings, const BenchOptions &options, SceneGenerator &generator)
+{
+    CharucoCalibrator calibrator;
+    cv::Mat trueCameraMatrix = SceneGenerator::cameraMatrixFor(settings.resolution);
+
+    std::vector<cv::Mat> views;
+    for (int i = 0; i < options.calibrationViews; i++) {
+        views.push_back(generator.renderCharuco(calibrator.getBoard(), settings));
+    }
+
+    std::vector<double> detectLatencies;
+    for (const cv::Mat &view : views) {
+        qint64 start = LatencyMetrics::now();
+        calibrator.addFrame(view);
+        detectLatencies.push_back((LatencyMetrics::now() - start) / 1e6);
+    }
+
+    QJsonObject result;
+    result["bench"] = "calibration";
+    result["scene"] = sceneJson(settings);
+    result["views"] = options.calibrationViews;
+    result["views_used"] = (int) calibrator.frameCount();
+    result["detect_ms"] = percentiles(detectLatencies);
+
+    if (calibrator.frameCount() > 0) {
+        cv::Mat cameraMatrix, distCoeffs;
+        try {
+            qint64 start = LatencyMetrics::now();
+            double rms = calibrator.calibrate(settings.resolution, cameraMatrix, distCoeffs);
+            result["solve_ms"] = (LatencyMetrics::now() - start) / 1e6;
+            result["rms"] = rms;
+
+            cv::Mat error = cameraMatrix - trueCameraMatrix;
+            result["fx_error_px"] = error.at<double>(0, 0);
+            result["fy_error_px"] = error.at<double>(1, 1);
+            result["cx_error_px"] = error.at<double>(0, 2);
+            result["cy_error_px"] = error.at<double>(1, 2);
+        } catch (const cv::Exception &e) {
+            result["error"] = e.what();
+        }
+    }
+    result["peak_rss_kb"] = peakRssKb();
+    return result;
+}
+
+// An import that moves block Y to the name X because they share markers and
+// adds a new block Y. The binary store, a reader replaying its journal and
+// the YAML file all have to end up with both blocks.
+static QJsonObject runStoreImportCheck(bool &exact)
+{
+    auto makeConfiguration = [](const std::string &name, const std::vector<int> &markerIds) {
+        Configuration config;
+        config.name = name;
+        config.markerIds = markerIds;
+        for (int markerId : markerIds) {
+            config.relativePoints[markerId] = cv::Point3f((float) markerId, 0.0f, 0.0f);
+        }
+        return config;
+    };
+    std::map<std::string, Configuration> existing = {{"Y", makeConfiguration("Y", {1, 2, 3, 4})}};
+    std::map<std::string, Configuration> incoming = {
+        {"X", makeConfiguration("X", {1, 2, 3, 4})},
+        {"Y", makeConfiguration("Y", {5, 6, 7, 8})}};
+    std::map<std::string, Configuration> expected = incoming;
+
+    QTemporaryDir directory;
+    YamlHandler yamlHandler;
+    std::map<std::string, Configuration> stored, replayed, yaml;
+
+    std::string storeFile = directory.filePath("configurations.bin").toStdString();
+    ImportReport storeReport;
+    ConfigurationStore journal;
+    bool written = yamlHandler.saveConfigurations(storeFile, existing)
+                   && journal.openSegments(QString::fromStdString(storeFile));
+    quint64 importGeneration = journal.fileGeneration();
+    quint64 importStart = journal.journalEnd();
+    // Writes wait for open stores
+    journal.close();
+    written = written
+              && yamlHandler.importConfigurations(
+                  storeFile, existing, ConfigurationIndex(existing), incoming, storeReport)
+              && yamlHandler.loadConfigurations(storeFile, stored)
+              && journal.openSince(
+                  QString::fromStdString(storeFile), importGeneration, importStart)
+              && journal.fileGeneration() == importGeneration;
+
+    // The same replay as ConfigurationRepository::refresh()
+    replayed = existing;
+    for (const ConfigurationView &view : journal.changesSince(importStart)) {
+        replayed.erase(std::string(view.name()));
+        if (!view.isDeleted())
+            replayed[std::string(view.name())] = view.toConfiguration();
+    }
+    journal.close();
+
+    std::string yamlFile = directory.filePath("configurations.yml").toStdString();
+    ImportReport yamlReport;
+    written = written && yamlHandler.saveConfigurations(yamlFile, existing)
+              && yamlHandler.importConfigurations(
+                  yamlFile, existing, ConfigurationIndex(existing), incoming, yamlReport)
+              && yamlHandler.loadConfigurations(yamlFile, yaml);
+
+    exact = written && stored == expected && replayed == expected && yaml == expected;
+
+    QJsonObject result;
+    result["bench"] = "store_import";
+    result["added"] = storeReport.added;
+    result["replaced"] = storeReport.replaced;
+    result["store_blocks"] = (int) stored.size();
+    result["replayed_blocks"] = (int) replayed.size();
+    result["yaml_blocks"] = (int) yaml.size();
+    result["exact"] = exact;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "End-to-end detection and calibration benchmark on synthetic scenes. "
+        "Prints one JSON object per scene configuration.");
+    parser.addHelpOption();
+    QCommandLineOption quickOption("quick", "Run a reduced scene matrix.");
+    QCommandLineOption iterationsOption(
+        "iterations", "Frames processed per marker scene configuration.", "count", "100");
+    QCommandLineOption seedOption("seed", "Random seed of the scene generator.", "seed", "1");
+    QCommandLineOption outputOption("output", "Write results to file instead of stdout.", "file");
+    QCommandLineOption verifyOption(
+        "verify",
+        "Only compare the fused threshold detector with OpenCV and tiled with "
+        "whole-frame detection and check the configuration store. Exits with 1 if any "
+        "threshold pixel, marker or block differs.");
+    parser.addOptions({quickOption, iterationsOption, seedOption, outputOption, verifyOption});
+    parser.process(app);
+
+    BenchOptions options;
+    options.quick = parser.isSet(quickOption);
+    options.verify = parser.isSet(verifyOption);
+    options.iterations = std::max(1, parser.value(iterationsOption).toInt());
+    if (options.quick) {
+        options.iterations = std::min(options.iterations, 20);
+        options.calibrationViews = 8;
+    }
+
+    QFile outputFile;
+    if (parser.isSet(outputOption)) {
+        outputFile.setFileName(parser.value(outputOption));
+        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            qCritical() << "Could not open output file" << outputFile.fileName();
+            return 1;
+        }
+    } else {
+        outputFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    QTextStream out(&outputFile);
+
+    MarkerDetector referenceDetector;
+    SceneGenerator generator(
+        referenceDetector.getDictionary(), MARKER_SIZE, parser.value(seedOption).toULongLong());
+
+    QJsonObject build;
+    build["bench"] = "build";
+    build["opencv"] = CV_VERSION;
+    build["qt"] = QT_VERSION_STR;
+    build["opencv_threads"] = cv::getNumThreads();
+    build["quick"] = options.quick;
+    out << QJsonDocument(build).toJson(QJsonDocument::Compact) << '\n';
+
+    std::vector<cv::Size> resolutions = {cv::Size(640, 480), cv::Size(1280, 720)};
+    if (!options.quick) {
+        resolutions.push_back(cv::Size(1920, 1080));
+        resolutions.push_back(cv::Size(3840, 2160));
+    }
+
+    std::vector<SceneSettings> markerScenes;
+    for (const cv::Size &resolution : resolutions) {
+        for (int markerCount : {1, 4, 16}) {
+            SceneSettings settings;
+            settings.resolution = resolution;
+            settings.markerCount = markerCount;
+            markerScenes.push_back(settings);
+        }
+    }
+    // Image quality and viewing angle are varied one at a time around a baseline
+    SceneSettings baseline;
+    baseline.resolution = cv::Size(1280, 720);
+    for (double blur : {1.0, 2.0}) {
+        SceneSettings settings = baseline;
+        settings.blurSigma = blur;
+        markerScenes.push_back(settings);
+    }
+    for (double noise : {5.0, 15.0}) {
+        SceneSettings settings = baseline;
+        settings.noiseSigma = noise;
+        markerScenes.push_back(settings);
+    }
+    for (double angle : {30.0, 60.0}) {
+        SceneSettings settings = baseline;
+        settings.angle = angle;
+        markerScenes.push_back(settings);
+    }
+
+    // Fused thresholds on every resolution and image quality, tiled detection
+    // and the block store, --verify ends here
+    bool allExact = true;
+    for (const SceneSettings &settings : markerScenes) {
+        if (settings.markerCount != 4)
+            continue;
+        bool exact = false;
+        out << QJsonDocument(runFusedBench(settings, options, generator, exact))
+                   .toJson(QJsonDocument::Compact)
+            << '\n';
+        out.flush();
+        allExact = allExact && exact;
+    }
+    // Tiled detection is meant for large frames with small markers
+    std::vector<SceneSettings> tileScenes;
+    for (int markerCount : {4, 16}) {
+        SceneSettings settings;
+        settings.resolution = options.quick ? cv::Size(1920, 1080) : cv::Size(3840, 2160);
+        settings.markerCount = markerCount;
+        tileScenes.push_back(settings);
+    }
+    for (const SceneSettings &settings : tileScenes) {
+        bool exact = false;
+        out << QJsonDocument(runTileBench(settings, options, generator, exact))
+                   .toJson(QJsonDocument::Compact)
+            << '\n';
+        out.flush();
+        allExact = allExact && exact;
+    }
+    bool storeExact = false;
+    out << QJsonDocument(runStoreImportCheck(storeExact)).toJson(QJsonDocument::Compact) << '\n';
+    out.flush();
+    allExact = allExact && storeExact;
+    if (options.verify)
+        return allExact ? 0 : 1;
+
+    for (const SceneSettings &settings : markerScenes) {
+        out << QJsonDocument(runMarkerBench(settings, options, generator))
+                   .toJson(QJsonDocument::Compact)
+            << '\n';
+        out.flush();
+    }
+
+    // Throughput and latency at each number of frames in flight
+    std::vector<int> workerCounts = {1, 2, 4};
+    int threadCount = std::min(
+        TaskExecutor::instance().threadCount(), DetectionPipeline::MAX_WORKERS);
+    if (!options.quick && threadCount > workerCounts.back())
+        workerCounts.push_back(threadCount);
+    SceneSettings pipelineScene;
+    pipelineScene.resolution = options.quick ? cv::Size(1280, 720) : cv::Size(1920, 1080);
+    pipelineScene.markerCount = 4;
+    for (int workers : workerCounts) {
+        out << QJsonDocument(runPipelineBench(pipelineScene, workers, options, generator))
+                   .toJson(QJsonDocument::Compact)
+            << '\n';
+        out.flush();
+    }
+
+    // Motion blur at the default processing size, for picking "Min sharpness"
+    SceneSettings sharpnessScene;
+    for (int blurLength : {0, 4, 8, 16, 32}) {
+        out << QJsonDocument(runSharpnessBench(sharpnessScene, blurLength, options, generator))
+                   .toJson(QJsonDocument::Compact)
+            << '\n';
+        out.flush();
+    }
+
+    std::vector<SceneSettings> calibrationScenes;
+    for (const cv::Size &resolution : resolutions) {
+        SceneSettings settings;
+        settings.resolution = resolution;
+        settings.angle = 30.0;
+        calibrationScenes.push_back(settings);
+    }
+    SceneSettings degraded;
+    degraded.resolution = cv::Size(1280, 720);
+    degraded.angle = 30.0;
+    degraded.blurSigma = 1.0;
+    degraded.noiseSigma = 5.0;
+    calibrationScenes.push_back(degraded);
+
+    for (const SceneSettings &settings : calibrationScenes) {
+        out << QJsonDocument(runCalibrationBench(settings, options, generator))
+                   .toJson(QJsonDocument::Compact)
+            << '\n';
+        out.flush();
+    }
+
+    return 0;
+}
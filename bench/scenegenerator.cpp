@@ -0,0 +1,188 @@
+#include "scenegenerator.h"
+
+// Rotation that makes a plane with +y up and +z towards the viewer face the camera
+static cv::Matx33d facingCamera()
+{
+    return cv::Matx33d(1, 0, 0, 0, -1, 0, 0, 0, -1);
+}
+
+static cv::Matx33d rotationX(double degrees)
+{
+    double a = degrees * CV_PI / 180.0;
+    return cv::Matx33d(1, 0, 0, 0, std::cos(a), -std::sin(a), 0, std::sin(a), std::cos(a));
+}
+
+static cv::Matx33d rotationY(double degrees)
+{
+    double a = degrees * CV_PI / 180.0;
+    return cv::Matx33d(std::cos(a), 0, std::sin(a), 0, 1, 0, -std::sin(a), 0, std::cos(a));
+}
+
+SceneGenerator::SceneGenerator(const cv::aruco::Dictionary &dictionary, float markerSize, uint64 seed)
+    : dictionary(dictionary)
+    , markerSize(markerSize)
+    , rng(seed)
+{}
+
+cv::Mat SceneGenerator::cameraMatrixFor(const cv::Size &resolution)
+{
+    // About 60 degrees of horizontal field of view
+    double f = resolution.width * 0.866;
+    cv::Mat cameraMatrix = cv::Mat::eye(3, 3, CV_64F);
+    cameraMatrix.at<double>(0, 0) = f;
+    cameraMatrix.at<double>(1, 1) = f;
+    cameraMatrix.at<double>(0, 2) = (resolution.width - 1) / 2.0;
+    cameraMatrix.at<double>(1, 2) = (resolution.height - 1) / 2.0;
+    return cameraMatrix;
+}
+
+MarkerScene SceneGenerator::renderMarkers(const SceneSettings &settings)
+{
+    MarkerScene scene;
+    scene.image = renderBackground(settings.resolution);
+    cv::Mat cameraMatrix = cameraMatrixFor(settings.resolution);
+    double f = cameraMatrix.at<double>(0, 0);
+
+    int count = std::max(1, std::min(settings.markerCount, dictionary.bytesList.rows));
+    int cols = (int) std::ceil(std::sqrt((double) count));
+    int rows = (count + cols - 1) / cols;
+    double spacing = markerSize * 2.0;
+
+    // Distance at which the marker grid covers about 60% of the frame
+    double distance = std::max(
+        f * cols * spacing / (0.6 * settings.resolution.width),
+        f * rows * spacing / (0.6 * settings.resolution.height));
+
+    cv::Matx33d rotation = rotationY(settings.angle) * facingCamera();
+    cv::Vec3d rvec;
+    cv::Rodrigues(rotation, rvec);
+
+    // Marker with a one cell quiet zone around it
+    int sidePixels = 240;
+    int margin = sidePixels / (dictionary.markerSize + 2);
+    float paddedSize = markerSize * (sidePixels + 2 * margin) / sidePixels;
+
+    for (int i = 0; i < count; i++) {
+        int r = i / cols, c = i % cols;
+        cv::Vec3d center((c - (cols - 1) / 2.0) * spacing, ((rows - 1) / 2.0 - r) * spacing, 0.0);
+        cv::Vec3d tvec = rotation * center + cv::Vec3d(0.0, 0.0, distance);
+
+        cv::Mat marker, padded, texture;
+        cv::aruco::generateImageMarker(dictionary, i, sidePixels, marker, 1);
+        cv::copyMakeBorder(
+            marker, padded, margin, margin, margin, margin, cv::BORDER_CONSTANT, cv::Scalar(255));
+        cv::cvtColor(padded, texture, cv::COLOR_GRAY2BGR);
+
+        drawPlanarTexture(
+            scene.image, texture, cv::Size2f(paddedSize, paddedSize), rvec, tvec, cameraMatrix);
+        scene.markers.push_back(MarkerGroundTruth{i, rvec, tvec});
+    }
+
+    degrade(scene.image, settings);
+    return scene;
+}
+
+cv::Mat SceneGenerator::renderCharuco(
+    const cv::Ptr<cv::aruco::CharucoBoard> &board, const SceneSettings &settings)
+{
+    cv::Mat image = renderBackground(settings.resolution);
+    cv::Mat cameraMatrix = cameraMatrixFor(settings.resolution);
+    double f = cameraMatrix.at<double>(0, 0);
+
+    cv::Size squares = board->getChessboardSize();
+    float squareLength = board->getSquareLength();
+    float margin = squareLength / 2.0f;
+    cv::Size2f physicalSize(
+        squares.width * squareLength + 2 * margin, squares.height * squareLength + 2 * margin);
+
+    float pixelsPerMm = 4.0f;
+    cv::Mat boardImage, texture;
+    board->generateImage(
+        cv::Size(
+            (int) (physicalSize.width * pixelsPerMm), (int) (physicalSize.height * pixelsPerMm)),
+        boardImage,
+        (int) (margin * pixelsPerMm),
+        1);
+    cv::cvtColor(boardImage, texture, cv::COLOR_GRAY2BGR);
+
+    // Calibration needs tilted views, frontal ones don't constrain the focal length
+    double maxTilt = std::max(15.0, settings.angle);
+    double tiltX = rng.uniform(-maxTilt, maxTilt);
+    double tiltY = rng.uniform(-maxTilt, maxTilt);
+    cv::Vec3d rvec;
+    cv::Rodrigues(rotationX(tiltX) * rotationY(tiltY) * facingCamera(), rvec);
+
+    double distance = std::max(
+        f * physicalSize.width / (0.7 * settings.resolution.width),
+        f * physicalSize.height / (0.7 * settings.resolution.height));
+    cv::Vec3d tvec(
+        rng.uniform(-0.1, 0.1) * physicalSize.width,
+        rng.uniform(-0.1, 0.1) * physicalSize.height,
+        distance);
+
+    drawPlanarTexture(image, texture, physicalSize, rvec, tvec, cameraMatrix);
+    degrade(image, settings);
+    return image;
+}
+
+cv::Mat SceneGenerator::renderBackground(const cv::Size &size)
+{
+    cv::Mat image(size, CV_8UC3, cv::Scalar(110, 120, 130));
+
+    // Some clutter, so that the detector has non-marker candidates to reject
+    for (int i = 0; i < 12; i++) {
+        cv::Point a(rng.uniform(0, size.width), rng.uniform(0, size.height));
+        cv::Point b(rng.uniform(0, size.width), rng.uniform(0, size.height));
+        int level = rng.uniform(0, 256);
+        if (i % 2 == 0) {
+            cv::rectangle(image, a, b, cv::Scalar(level, level, level), cv::FILLED);
+        } else {
+            cv::line(image, a, b, cv::Scalar(level, level, level), rng.uniform(1, 4));
+        }
+    }
+    return image;
+}
+
+void SceneGenerator::drawPlanarTexture(
+    cv::Mat &canvas,
+    const cv::Mat &texture,
+    const cv::Size2f &physicalSize,
+    const cv::Vec3d &rvec,
+    const cv::Vec3d &tvec,
+    const cv::Mat &cameraMatrix)
+{
+    float w = physicalSize.width / 2.0f, h = physicalSize.height / 2.0f;
+    std::vector<cv::Point3f> objectCorners = {{-w, h, 0}, {w, h, 0}, {w, -h, 0}, {-w, -h, 0}};
+    std::vector<cv::Point2f> imageCorners;
+    cv::projectPoints(objectCorners, rvec, tvec, cameraMatrix, cv::noArray(), imageCorners);
+
+    // Texture edges lie half a pixel outside of the outermost pixel centers
+    float right = texture.cols - 0.5f, bottom = texture.rows - 0.5f;
+    std::vector<cv::Point2f> textureCorners = {
+        {-0.5f, -0.5f}, {right, -0.5f}, {right, bottom}, {-0.5f, bottom}};
+    cv::Mat homography = cv::getPerspectiveTransform(textureCorners, imageCorners);
+
+    cv::Mat warped, mask;
+    cv::warpPerspective(texture, warped, homography, canvas.size(), cv::INTER_LINEAR);
+    cv::warpPerspective(
+        cv::Mat(texture.size(), CV_8UC1, cv::Scalar(255)),
+        mask,
+        homography,
+        canvas.size(),
+        cv::INTER_NEAREST);
+    warped.copyTo(canvas, mask);
+}
+
+void SceneGenerator::degrade(cv::Mat &image, const SceneSettings &settings)
+{
+    if (settings.blurSigma > 0.0) {
+        cv::GaussianBlur(image, image, cv::Size(), settings.blurSigma);
+    }
+    if (settings.noiseSigma > 0.0) {
+        cv::Mat noisy, noise(image.size(), CV_16SC3);
+        rng.fill(noise, cv::RNG::NORMAL, 0.0, settings.noiseSigma);
+        image.convertTo(noisy, CV_16SC3);
+        noisy += noise;
+        noisy.convertTo(image, CV_8UC3);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include <opencv2/aruco.hpp>
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/opencv.hpp>
+
+struct SceneSettings
+{
+    cv::Size resolution = cv::Size(640, 480);
+    int markerCount = 4;
+    double blurSigma = 0.0;
+    double noiseSigma = 0.0;
+    // Rotation of the marker plane around the vertical axis, degrees
+    double angle = 0.0;
+};
+
+struct MarkerGroundTruth
+{
+    int id;
+    cv::Vec3d rvec;
+    cv::Vec3d tvec;
+};
+
+struct MarkerScene
+{
+    cv::Mat image;
+    std::vector<MarkerGroundTruth> markers;
+};
+
+// Renders synthetic camera frames with markers at known poses. The virtual
+// camera has no distortion and the intrinsics returned by cameraMatrixFor().
+class SceneGenerator
+{
+public:
+    SceneGenerator(const cv::aruco::Dictionary &dictionary, float markerSize, uint64 seed);
+
+    static cv::Mat cameraMatrixFor(const cv::Size &resolution);
+
+    MarkerScene renderMarkers(const SceneSettings &settings);
+    // Board is placed at a random pose tilted by up to settings.angle
+    cv::Mat renderCharuco(const cv::Ptr<cv::aruco::CharucoBoard> &board, const SceneSettings &settings);
+
+private:
+    cv::aruco::Dictionary dictionary;
+    float markerSize;
+    cv::RNG rng;
+
+    cv::Mat renderBackground(const cv::Size &size);
+    void drawPlanarTexture(
+        cv::Mat &canvas,
+        const cv::Mat &texture,
+        const cv::Size2f &physicalSize,
+        const cv::Vec3d &rvec,
+        const cv::Vec3d &tvec,
+        const cv::Mat &cameraMatrix);
+    void degrade(cv::Mat &image, const SceneSettings &settings);
+};
+
+#endif // SCENEGENERATOR_H
@@ -0,0 +1,122 @@
+#include "calibrationtask.h"
+#include "latencymetrics.h"
+#include <QDebug>
+
+CalibrationTask::CalibrationTask(QObject *parent)
+    : QObject(parent)
+    , yamlHandler(nullptr)
+    , outputFile("calibration.yml")
+{}
+
+void CalibrationTask::setDetectorSettings(const DetectorSettings &settings)
+{
+    QMutexLocker locker(&mutex);
+    detectorSettings = settings;
+}
+
+void CalibrationTask::setOutputFile(const std::string &fileName)
+{
+    QMutexLocker locker(&mutex);
+    outputFile = fileName;
+}
+
+void CalibrationTask::start()
+{
+    if (task.isRunning())
+        return;
+    task = TaskExecutor::instance().submit(
+        [this](const CancellationToken &token) { run(token); });
+}
+
+void CalibrationTask::run(const CancellationToken &token)
+{
+    std::string fileName;
+    {
+        QMutexLocker locker(&mutex);
+        calibrator.setDetectorSettings(detectorSettings);
+        fileName = outputFile;
+    }
+    frames.clear();
+    calibrator.clear();
+
+    QString imagesDir = QDir::currentPath() + "/images";
+    QDir dir(imagesDir);
+    QStringList filters;
+    filters << "*.png"
+            << "*.jpg"
+            << "*.jpeg";
+    dir.setNameFilters(filters);
+    QStringList fileNames = dir.entryList();
+
+    if (fileNames.isEmpty()) {
+        emit taskFinished(false, QString(tr("No images in directory %1")).arg(imagesDir));
+        return;
+    }
+
+    TaskExecutor &executor = TaskExecutor::instance();
+    std::vector<cv::Mat> loaded(fileNames.size());
+    executor.parallelFor(fileNames.size(), [&](int i) {
+        if (token.isCancelled())
+            return;
+        QString filePath = imagesDir + "/" + fileNames.at(i);
+        // Detection only needs luma
+        loaded[i] = cv::imread(filePath.toStdString(), cv::IMREAD_GRAYSCALE);
+        if (loaded[i].empty())
+            qWarning() << "Could not load image: " << fileNames.at(i);
+    });
+    if (token.isCancelled())
+        return;
+
+    for (cv::Mat &frame : loaded) {
+        if (!frame.empty())
+            frames.push_back(frame);
+    }
+    if (frames.empty()) {
+        emit taskFinished(false, tr("Could not transform images to cv::Mat"));
+        return;
+    }
+
+    // Detected in parallel, added in file order so the result does not depend on timing
+    std::vector<std::vector<cv::Point2f>> corners(frames.size());
+    std::vector<std::vector<int>> ids(frames.size());
+    std::vector<char> usable(frames.size(), 0);
+    executor.parallelFor(frames.size(), [&](int i) {
+        if (token.isCancelled())
+            return;
+        ScopedStageTimer timer(Stage::CalibrationDetect);
+        usable[i] = calibrator.detectFrame(frames[i], corners[i], ids[i]);
+    });
+    if (token.isCancelled())
+        return;
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (usable[i])
+            calibrator.addDetection(corners[i], ids[i]);
+    }
+
+    if (calibrator.frameCount() == 0) {
+        emit taskFinished(false, tr("Not enough data to begin calibration"));
+        return;
+    }
+
+    try {
+        cv::Mat cameraMatrix, distCoeffs;
+        ScopedStageTimer timer(Stage::CalibrationSolve);
+        double rms = calibrator.calibrate(frames[0].size(), cameraMatrix, distCoeffs);
+        timer.stop();
+
+        if (rms > 0) {
+            if (yamlHandler->saveCalibrationParameters(fileName, cameraMatrix, distCoeffs)) {
+                emit taskFinished(
+                    true, QString(tr("Calibration completed successfully with RMS = %1")).arg(rms));
+            } else {
+                emit taskFinished(
+                    false, tr("Error occured while saving calibration parameters to file"));
+            }
+        } else {
+            emit taskFinished(false, QString(tr("Calibration failed with RMS = %1")).arg(rms));
+        }
+    } catch (const cv::Exception &e) {
+        emit taskFinished(false, QString(tr("Calibration error: %1")).arg(e.what()));
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef CALIBRATIONTASK_H
+#define CALIBRATIONTASK_H
+
+#include "charucocalibrator.h"
+#include "taskexecutor.h"
+#include "yamlhandler.h"
+#include <opencv2/opencv.hpp>
+#include <QDir>
+#include <QMutex>
+#include <QObject>
+
+// Calibrates from the saved images on the shared executor. Loading and
+// detection are spread over the pool, the solve itself runs on one worker.
+class CalibrationTask : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CalibrationTask(QObject *parent = nullptr);
+
+    void setYamlHandler(YamlHandler *handler) { yamlHandler = handler; }
+    void setDetectorSettings(const DetectorSettings &settings);
+    // Calibration of the camera the images were taken with
+    void setOutputFile(const std::string &fileName);
+    // Does nothing while a previous run is still going
+    void start();
+    // Stops before the next step, a solve already underway still finishes
+    void cancel() { task.cancel(); }
+    void wait() { task.wait(); }
+    bool isRunning() const { return task.isRunning(); }
+
+signals:
+    void taskFinished(bool success, const QString &message);
+
+private:
+    YamlHandler *yamlHandler;
+    TaskHandle task;
+    QMutex mutex;
+    std::vector<cv::Mat> frames;
+    CharucoCalibrator calibrator;
+    DetectorSettings detectorSettings;
+    std::string outputFile;
+
+    void run(const CancellationToken &token);
+};
+
+#endif // CALIBRATIONTASK_H
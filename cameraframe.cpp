@@ -0,0 +1,104 @@
+#include "cameraframe.h"
+
+namespace {
+
+// Width of the copy sharpness is measured on. Blur of a few pixels at the
+// processing size still shows at this scale.
+constexpr int SHARPNESS_WIDTH = 320;
+
+// Shrinking averages whole source pixels, so fine marker edges do not alias
+void scale(const cv::Mat &src, cv::Mat &dst, const cv::Size &size)
+{
+    bool shrink = size.width < src.cols || size.height < src.rows;
+    cv::resize(src, dst, size, 0, 0, shrink ? cv::INTER_AREA : cv::INTER_LINEAR);
+}
+
+} // namespace
+
+CameraFrame::CameraFrame(
+    const cv::Mat &rawFrame, const cv::Size &size, const cv::Size &processingSize)
+    : raw(rawFrame)
+{
+    if (raw.type() == CV_8UC1 && (int) raw.total() == size.area() * 2 && raw.rows != size.height) {
+        // Some backends hand out packed YUYV as one row of bytes
+        raw = raw.reshape(2, size.height);
+    }
+
+    imageSize = raw.type() == CV_8UC1 && raw.rows == size.height * 3 / 2 ? size : raw.size();
+    bool scaled = !processingSize.empty() && processingSize != imageSize;
+
+    // Scaling comes first, so the full frame is read only once and the
+    // conversion runs on the small image
+    cv::Mat small;
+    if (raw.type() == CV_8UC3) {
+        pixelFormat = PixelFormat::Bgr;
+        if (scaled) {
+            scale(raw, small, processingSize);
+            cv::cvtColor(small, lumaPlane, cv::COLOR_BGR2GRAY);
+        } else {
+            cv::cvtColor(raw, lumaPlane, cv::COLOR_BGR2GRAY);
+        }
+    } else if (raw.type() == CV_8UC2) {
+        // Luma is every other byte. Scaling both channels keeps the luma
+        // samples intact, the mixed chroma channel is dropped afterwards.
+        pixelFormat = PixelFormat::Yuyv;
+        if (scaled) {
+            scale(raw, small, processingSize);
+            cv::extractChannel(small, lumaPlane, 0);
+        } else {
+            cv::extractChannel(raw, lumaPlane, 0);
+        }
+    } else if (raw.type() == CV_8UC1 && raw.rows == size.height * 3 / 2
+               && raw.cols == size.width) {
+        // The Y plane comes first, followed by interleaved chroma at half resolution
+        pixelFormat = PixelFormat::Nv12;
+        cv::Mat plane = raw.rowRange(0, size.height);
+        if (scaled) {
+            scale(plane, lumaPlane, processingSize);
+        } else {
+            lumaPlane = plane;
+        }
+    } else if (raw.type() == CV_8UC1 && raw.rows == size.height) {
+        pixelFormat = PixelFormat::Grey;
+        if (scaled) {
+            scale(raw, lumaPlane, processingSize);
+        } else {
+            lumaPlane = raw;
+        }
+    }
+}
+
+void CameraFrame::toRgb(cv::Mat &rgb) const
+{
+    switch (pixelFormat) {
+    case PixelFormat::Grey:
+        cv::cvtColor(raw, rgb, cv::COLOR_GRAY2RGB);
+        break;
+    case PixelFormat::Bgr:
+        cv::cvtColor(raw, rgb, cv::COLOR_BGR2RGB);
+        break;
+    case PixelFormat::Yuyv:
+        cv::cvtColor(raw, rgb, cv::COLOR_YUV2RGB_YUYV);
+        break;
+    case PixelFormat::Nv12:
+        cv::cvtColor(raw, rgb, cv::COLOR_YUV2RGB_NV12);
+        break;
+    }
+}
+
+void CameraFrame::measureSharpness()
+{
+    if (lumaPlane.empty())
+        return;
+
+    cv::Mat small = lumaPlane;
+    if (lumaPlane.cols > SHARPNESS_WIDTH) {
+        int height = std::max(1, lumaPlane.rows * SHARPNESS_WIDTH / lumaPlane.cols);
+        cv::resize(lumaPlane, small, cv::Size(SHARPNESS_WIDTH, height), 0, 0, cv::INTER_AREA);
+    }
+    cv::Mat laplacian;
+    cv::Laplacian(small, laplacian, CV_16S);
+    cv::Scalar mean, deviation;
+    cv::meanStdDev(laplacian, mean, deviation);
+    sharpnessValue = deviation[0] * deviation[0];
+}
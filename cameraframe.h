@@ -0,0 +1,47 @@
+#ifndef CAMERAFRAME_H
+#define CAMERAFRAME_H
+
+#include <limits>
+#include <opencv2/opencv.hpp>
+
+enum class PixelFormat { Grey, Bgr, Yuyv, Nv12 };
+
+// One frame as the device delivered it. Detection only needs the luma plane,
+// which is a view into the raw data where the layout and size allow. Colour is
+// converted from the raw data on request, only for frames that are shown.
+// Copies share the data, the capture loop reads every frame into a new buffer.
+class CameraFrame
+{
+public:
+    CameraFrame() = default;
+    // size is the image size the device reports, raw the data as read. Luma
+    // is scaled to processingSize unless that is empty. Empty if the layout
+    // of raw is not recognized.
+    CameraFrame(const cv::Mat &raw, const cv::Size &size, const cv::Size &processingSize);
+
+    bool empty() const { return lumaPlane.empty(); }
+    PixelFormat format() const { return pixelFormat; }
+    // Processing size, the size of luma()
+    cv::Size size() const { return lumaPlane.size(); }
+    cv::Size deviceSize() const { return imageSize; }
+    // Single channel, 8 bit
+    const cv::Mat &luma() const { return lumaPlane; }
+
+    // Converts the whole frame at device size
+    void toRgb(cv::Mat &rgb) const;
+
+    // Variance of the Laplacian of a small copy of luma. Motion blur wipes out
+    // the edges it responds to, so blurred frames score low. Frames that were
+    // never measured count as sharp.
+    void measureSharpness();
+    double sharpness() const { return sharpnessValue; }
+
+private:
+    cv::Mat raw;
+    cv::Mat lumaPlane;
+    cv::Size imageSize;
+    PixelFormat pixelFormat = PixelFormat::Grey;
+    double sharpnessValue = std::numeric_limits<double>::infinity();
+};
+
+#endif // CAMERAFRAME_H
@@ -0,0 +1,21 @@
+#include "camerapipeline.h"
+
+CameraPipeline::CameraPipeline(int index, const CameraSettings &settings, TrackingStream *stream)
+    : cameraIndex(index)
+    , captureService(settings.device, settings.processingSize, settings.fps)
+    , calibrated(false)
+    , calibrationFileName(settings.calibrationFile)
+{
+    rawStage.setCamera(index);
+    rawStage.setFrameMailbox(&mailbox);
+    trackingStage.setFrameMailbox(&mailbox);
+    trackingStage.setResultStream(stream, index);
+}
+
+void CameraPipeline::applyCalibration(const CalibrationParams &params, const std::string &fileName)
+{
+    calibrated = true;
+    calibrationParams = params;
+    calibrationFileName = fileName;
+    trackingStage.setCalibrationParams(calibrationParams);
+}
@@ -0,0 +1,46 @@
+#ifndef CAMERAPIPELINE_H
+#define CAMERAPIPELINE_H
+
+#include "camerastage.h"
+#include "captureservice.h"
+#include "framemailbox.h"
+#include "markerstage.h"
+#include "yamlhandler.h"
+
+class TrackingStream;
+
+// Everything that belongs to one camera of the station: its capture thread,
+// both stages, its display mailbox and its calibration. Pipelines run side by
+// side, each on its own capture thread, and share the executor for the
+// parallel parts of detection.
+class CameraPipeline
+{
+public:
+    CameraPipeline(int index, const CameraSettings &settings, TrackingStream *stream);
+
+    int index() const { return cameraIndex; }
+    CaptureService &capture() { return captureService; }
+    CameraStage &cameraStage() { return rawStage; }
+    MarkerStage &markerStage() { return trackingStage; }
+    FrameMailbox *frameMailbox() { return &mailbox; }
+
+    // Calibration state is kept on the GUI thread, the tracker gets a copy
+    bool isCalibrated() const { return calibrated; }
+    const std::string &calibrationFile() const { return calibrationFileName; }
+    void applyCalibration(const CalibrationParams &params, const std::string &fileName);
+    // After a failed load, tracking needs a valid file again
+    void invalidateCalibration() { calibrated = false; }
+
+private:
+    int cameraIndex;
+    CaptureService captureService;
+    CameraStage rawStage;
+    MarkerStage trackingStage;
+    FrameMailbox mailbox;
+
+    bool calibrated;
+    CalibrationParams calibrationParams;
+    std::string calibrationFileName;
+};
+
+#endif // CAMERAPIPELINE_H
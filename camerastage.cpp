@@ -0,0 +1,56 @@
+#include "camerastage.h"
+#include "latencymetrics.h"
+#include <QCoreApplication>
+
+CameraStage::CameraStage()
+    : minSharpness(0.0)
+    , frameMailbox(nullptr)
+    , camera(0)
+{}
+
+void CameraStage::process(const CameraFrame &frame)
+{
+    qint64 frameStart = LatencyMetrics::now();
+    {
+        QMutexLocker locker(&mutex);
+        currentFrame = frame;
+    }
+
+    if (frameMailbox && frameMailbox->isActive()) {
+        ScopedStageTimer timer(Stage::Convert);
+        QImage image = displayPool.convert(frame, frame.size());
+        timer.stop();
+        frameMailbox->post(image, FrameOverlay(), LatencyMetrics::now());
+    }
+    LatencyMetrics::instance().recordFrame(camera, frameStart, LatencyMetrics::now());
+}
+
+bool CameraStage::saveCurrentFrame(const QString &directory, int frameNumber, QString &error)
+{
+    QMutexLocker locker(&mutex);
+    if (currentFrame.empty()) {
+        error = QCoreApplication::translate("CameraStage", "No frame to save");
+        return false;
+    }
+    if (currentFrame.sharpness() < minSharpness) {
+        error = QCoreApplication::translate(
+                    "CameraStage", "Frame is too blurred (sharpness %1, at least %2 needed)")
+                    .arg(currentFrame.sharpness(), 0, 'f', 0)
+                    .arg(minSharpness, 0, 'f', 0);
+        return false;
+    }
+
+    // Already at the processing size, the size tracking is calibrated for
+    QString filePath = directory + QString("/frame_%1.png").arg(frameNumber, 3, 10, QChar('0'));
+    if (!cv::imwrite(filePath.toStdString(), currentFrame.luma())) {
+        error = QCoreApplication::translate("CameraStage", "Could not save frame");
+        return false;
+    }
+    return true;
+}
+
+void CameraStage::setMinSharpness(double sharpness)
+{
+    QMutexLocker locker(&mutex);
+    minSharpness = sharpness;
+}
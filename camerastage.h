@@ -0,0 +1,37 @@
+#ifndef CAMERASTAGE_H
+#define CAMERASTAGE_H
+
+#include "displayframepool.h"
+#include "framemailbox.h"
+#include "framestage.h"
+#include <opencv2/opencv.hpp>
+#include <QMutex>
+#include <QString>
+
+// Calibration mode: shows the raw feed and keeps the latest frame for capture.
+// Captured images are greyscale, calibration only looks at luma. Blurred
+// frames are not captured, their corners would skew the calibration.
+class CameraStage : public FrameStage
+{
+public:
+    CameraStage();
+
+    void process(const CameraFrame &frame) override;
+    // On failure error says why
+    bool saveCurrentFrame(const QString &directory, int frameNumber, QString &error);
+    void setMinSharpness(double sharpness);
+    void setFrameMailbox(FrameMailbox *mailbox) { frameMailbox = mailbox; }
+    // Set before capture starts, for the per-camera metrics
+    void setCamera(int index) { camera = index; }
+
+private:
+    // Shares the capture buffer, the next frame is read into a new one
+    CameraFrame currentFrame;
+    double minSharpness;
+    QMutex mutex;
+    DisplayFramePool displayPool;
+    FrameMailbox *frameMailbox;
+    int camera;
+};
+
+#endif // CAMERASTAGE_H
@@ -0,0 +1,50 @@
+#include "captureservice.h"
+
+CaptureService::CaptureService(int deviceIndex, const cv::Size &processingSize, double fps)
+    : source(deviceIndex, processingSize, fps)
+    , requestedStage(nullptr)
+{
+    source.setPaused(true);
+}
+
+void CaptureService::start()
+{
+    if (task.isRunning())
+        return;
+    // Blocks on the device for its whole life, so it gets a thread of its own
+    task = TaskExecutor::instance().submitLongRunning(
+        [this](const CancellationToken &token) { run(token); });
+}
+
+void CaptureService::setStage(FrameStage *stage)
+{
+    QMutexLocker locker(&mutex);
+    requestedStage = stage;
+    // Cameras no page needs stop reading instead of dropping frames
+    source.setPaused(!requestedStage);
+}
+
+void CaptureService::stop()
+{
+    task.cancel();
+    // Wakes the loop when it is paused or backing off
+    source.stop();
+}
+
+void CaptureService::run(const CancellationToken &token)
+{
+    source.start();
+
+    CameraFrame frame;
+    while (!token.isCancelled() && source.read(frame)) {
+        FrameStage *stage;
+        {
+            QMutexLocker locker(&mutex);
+            stage = requestedStage;
+        }
+        if (stage)
+            stage->process(frame);
+    }
+
+    source.close();
+}
@@ -0,0 +1,36 @@
+#ifndef CAPTURESERVICE_H
+#define CAPTURESERVICE_H
+
+#include "framestage.h"
+#include "taskexecutor.h"
+#include "videosource.h"
+#include <QMutex>
+
+// Owns one camera for the lifetime of the application. Calibration capture
+// and marker tracking are stages attached to it, switching modes swaps the
+// stage between two frames and never reopens the device.
+class CaptureService
+{
+public:
+    CaptureService(int deviceIndex, const cv::Size &processingSize, double fps);
+
+    // Runs the capture loop as a long-running task of the shared executor
+    void start();
+    // The stage must outlive the service, nullptr pauses capture
+    void setStage(FrameStage *stage);
+    void stop();
+    void wait() { task.wait(); }
+    CaptureState state() const { return source.state(); }
+    CaptureMode mode() const { return source.mode(); }
+
+private:
+    VideoSource source;
+    TaskHandle task;
+
+    QMutex mutex;
+    FrameStage *requestedStage;
+
+    void run(const CancellationToken &token);
+};
+
+#endif // CAPTURESERVICE_H
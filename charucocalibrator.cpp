@@ -0,0 +1,71 @@
+#include "charucocalibrator.h"
+
+CharucoCalibrator::CharucoCalibrator()
+{
+    int squaresX = 7, squaresY = 5;
+    float squareLength = 40.0f, markerLength = 20.0f;
+    dictionary = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250);
+    detector = cv::aruco::ArucoDetector(dictionary, cv::aruco::DetectorParameters());
+    charucoBoard = new cv::aruco::CharucoBoard(
+        cv::Size(squaresX, squaresY), squareLength, markerLength, dictionary);
+}
+
+void CharucoCalibrator::setDetectorSettings(const DetectorSettings &settings)
+{
+    cv::aruco::DetectorParameters params = settings.toDetectorParameters();
+    detector = cv::aruco::ArucoDetector(dictionary, params);
+    fusedDetector = FusedMarkerDetector(dictionary, params);
+    useFusedDetector = settings.useFusedThreshold && FusedMarkerDetector::supports(params);
+}
+
+bool CharucoCalibrator::addFrame(const cv::Mat &frame)
+{
+    std::vector<cv::Point2f> charucoCorners;
+    std::vector<int> charucoIds;
+    if (!detectFrame(frame, charucoCorners, charucoIds))
+        return false;
+
+    addDetection(charucoCorners, charucoIds);
+    return true;
+}
+
+bool CharucoCalibrator::detectFrame(
+    const cv::Mat &frame,
+    std::vector<cv::Point2f> &charucoCorners,
+    std::vector<int> &charucoIds) const
+{
+    std::vector<int> ids;
+    std::vector<std::vector<cv::Point2f>> corners, corners_rejected;
+    if (useFusedDetector) {
+        fusedDetector.detectMarkers(frame, corners, ids);
+    } else {
+        detector.detectMarkers(frame, corners, ids, corners_rejected);
+    }
+    if (ids.empty())
+        return false;
+
+    cv::aruco::interpolateCornersCharuco(
+        corners, ids, frame, charucoBoard, charucoCorners, charucoIds);
+    return charucoCorners.size() >= 4;
+}
+
+void CharucoCalibrator::addDetection(
+    const std::vector<cv::Point2f> &corners, const std::vector<int> &ids)
+{
+    allCorners.push_back(corners);
+    allIds.push_back(ids);
+}
+
+void CharucoCalibrator::clear()
+{
+    allCorners.clear();
+    allIds.clear();
+}
+
+double CharucoCalibrator::calibrate(
+    const cv::Size &imageSize, cv::Mat &cameraMatrix, cv::Mat &distCoeffs)
+{
+    std::vector<cv::Mat> rvecs, tvecs;
+    return cv::aruco::calibrateCameraCharuco(
+        allCorners, allIds, charucoBoard, imageSize, cameraMatrix, distCoeffs, rvecs, tvecs);
+}
@@ -0,0 +1,43 @@
+#ifndef CHARUCOCALIBRATOR_H
+#define CHARUCOCALIBRATOR_H
+
+#include "fusedmarkerdetector.h"
+#include "yamlhandler.h"
+#include <opencv2/aruco.hpp>
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/opencv.hpp>
+
+// Collects ChArUco corners from calibration frames and solves for the camera
+// intrinsics. Only detectFrame() may be called from several threads at once.
+class CharucoCalibrator
+{
+public:
+    CharucoCalibrator();
+
+    void setDetectorSettings(const DetectorSettings &settings);
+    cv::Ptr<cv::aruco::CharucoBoard> getBoard() const { return charucoBoard; }
+
+    // Returns true if the frame contained enough corners to be used
+    bool addFrame(const cv::Mat &frame);
+    // addFrame() in two steps, so the detection can run in parallel
+    bool detectFrame(
+        const cv::Mat &frame, std::vector<cv::Point2f> &corners, std::vector<int> &ids) const;
+    void addDetection(const std::vector<cv::Point2f> &corners, const std::vector<int> &ids);
+    size_t frameCount() const { return allCorners.size(); }
+    void clear();
+
+    // Returns RMS reprojection error, throws cv::Exception on failure
+    double calibrate(const cv::Size &imageSize, cv::Mat &cameraMatrix, cv::Mat &distCoeffs);
+
+private:
+    cv::Ptr<cv::aruco::CharucoBoard> charucoBoard;
+    cv::aruco::Dictionary dictionary;
+    cv::aruco::ArucoDetector detector;
+    FusedMarkerDetector fusedDetector;
+    bool useFusedDetector = false;
+
+    std::vector<std::vector<cv::Point2f>> allCorners;
+    std::vector<std::vector<int>> allIds;
+};
+
+#endif // CHARUCOCALIBRATOR_H
@@ -0,0 +1,30 @@
+#include "configurationcompactor.h"
+#include "configurationstore.h"
+#include <QDebug>
+
+ConfigurationCompactor::ConfigurationCompactor(QObject *parent)
+    : QObject(parent)
+{}
+
+void ConfigurationCompactor::compactIfNeeded()
+{
+    if (fileName.isEmpty() || task.isRunning())
+        return;
+    // Low priority, detection and file work are never held up by it
+    task = TaskExecutor::instance().submit(
+        [this](const CancellationToken &) { run(); }, TaskPriority::Low);
+}
+
+void ConfigurationCompactor::run()
+{
+    {
+        ConfigurationStore store;
+        if (!store.openSegments(fileName) || !store.needsCompaction())
+            return;
+    }
+
+    bool success = ConfigurationStore::compact(fileName);
+    if (!success)
+        qWarning() << "Configuration journal compaction failed, will retry later";
+    emit compacted(success);
+}
@@ -0,0 +1,31 @@
+#ifndef CONFIGURATIONCOMPACTOR_H
+#define CONFIGURATIONCOMPACTOR_H
+
+#include "taskexecutor.h"
+#include <QObject>
+
+// Folds the configuration journal into a fresh snapshot in the background
+// once it has grown past ConfigurationStore::needsCompaction()
+class ConfigurationCompactor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigurationCompactor(QObject *parent = nullptr);
+
+    void setFileName(const QString &name) { fileName = name; }
+    void wait() { task.wait(); }
+
+public slots:
+    void compactIfNeeded();
+
+signals:
+    void compacted(bool success);
+
+private:
+    QString fileName;
+    TaskHandle task;
+
+    void run();
+};
+
+#endif // CONFIGURATIONCOMPACTOR_H
@@ -0,0 +1,86 @@
+#include "configurationindex.h"
+#include <algorithm>
+
+ConfigurationIndex::ConfigurationIndex(const std::map<std::string, Configuration> &configurations)
+{
+    for (const auto &entry : configurations) {
+        insert(entry.second);
+    }
+}
+
+void ConfigurationIndex::insert(const Configuration &config)
+{
+    for (int markerId : config.markerIds) {
+        std::vector<std::string> &blocks = blocksByMarkerId[markerId];
+        if (std::find(blocks.begin(), blocks.end(), config.name) == blocks.end())
+            blocks.push_back(config.name);
+    }
+}
+
+void ConfigurationIndex::erase(const Configuration &config)
+{
+    for (int markerId : config.markerIds) {
+        auto it = blocksByMarkerId.find(markerId);
+        if (it == blocksByMarkerId.end())
+            continue;
+        std::vector<std::string> &blocks = it->second;
+        blocks.erase(std::remove(blocks.begin(), blocks.end(), config.name), blocks.end());
+        if (blocks.empty())
+            blocksByMarkerId.erase(it);
+    }
+}
+
+ConflictType ConfigurationIndex::findConflict(
+    const std::map<std::string, Configuration> &configurations,
+    const Configuration &config,
+    std::string &duplicateName) const
+{
+    std::vector<int> markerIds(config.markerIds);
+    std::sort(markerIds.begin(), markerIds.end());
+    markerIds.erase(std::unique(markerIds.begin(), markerIds.end()), markerIds.end());
+
+    // How many of the checked markers every overlapping block uses
+    std::map<std::string, size_t> sharedMarkers;
+    for (int markerId : markerIds) {
+        auto it = blocksByMarkerId.find(markerId);
+        if (it == blocksByMarkerId.end())
+            continue;
+        for (const std::string &name : it->second) {
+            sharedMarkers[name]++;
+        }
+    }
+
+    bool markerIdMatches = false;
+    std::string markerIdMatchConfig;
+    for (const auto &entry : sharedMarkers) {
+        auto existing = configurations.find(entry.first);
+        if (existing == configurations.end())
+            continue;
+        size_t existingCount = existing->second.markerIds.size();
+        // A block sharing only part of its markers with the checked one
+        if (entry.second != existingCount) {
+            duplicateName = "";
+            return ConflictType::Intersection;
+        }
+        if (existingCount == markerIds.size()) {
+            markerIdMatches = true;
+            markerIdMatchConfig = entry.first;
+        }
+    }
+
+    bool nameMatches = configurations.find(config.name) != configurations.end();
+    if (nameMatches && !markerIdMatches) {
+        duplicateName = config.name;
+        return ConflictType::ExactMatch;
+    } else if (!nameMatches && markerIdMatches) {
+        duplicateName = markerIdMatchConfig;
+        return ConflictType::ExactMatch;
+    } else if (nameMatches && markerIdMatches && config.name == markerIdMatchConfig) {
+        duplicateName = config.name;
+        return ConflictType::ExactMatch;
+    } else if (nameMatches && markerIdMatches && config.name != markerIdMatchConfig) {
+        return ConflictType::Intersection;
+    }
+
+    return ConflictType::None;
+}
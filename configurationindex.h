@@ -0,0 +1,30 @@
+#ifndef CONFIGURATIONINDEX_H
+#define CONFIGURATIONINDEX_H
+
+#include "yamlhandler.h"
+#include <unordered_map>
+
+// Marker id to the blocks using it, kept next to a block library keyed by
+// name. Conflict checks only look at the markers of the checked block, so
+// they do not get slower as the library grows.
+class ConfigurationIndex
+{
+public:
+    ConfigurationIndex() = default;
+    explicit ConfigurationIndex(const std::map<std::string, Configuration> &configurations);
+
+    void insert(const Configuration &config);
+    void erase(const Configuration &config);
+
+    // Name match, marker set match or a partial overlap with another block.
+    // The library passed in must be the one this index was built for.
+    ConflictType findConflict(
+        const std::map<std::string, Configuration> &configurations,
+        const Configuration &config,
+        std::string &duplicateName) const;
+
+private:
+    std::unordered_map<int, std::vector<std::string>> blocksByMarkerId;
+};
+
+#endif // CONFIGURATIONINDEX_H
@@ -0,0 +1,147 @@
+#include "configurationmodel.h"
+#include <algorithm>
+#include <iterator>
+
+ConfigurationModel::ConfigurationModel(QObject *parent)
+    : QAbstractListModel(parent)
+{}
+
+int ConfigurationModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : (int) rows.size();
+}
+
+QVariant ConfigurationModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= (int) rows.size())
+        return QVariant();
+
+    const Configuration &config = rows[index.row()].second;
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return QString::fromStdString(config.name);
+    case TypeRole:
+        return QString::fromStdString(config.type);
+    case MarkerIdsRole: {
+        QStringList ids;
+        for (int id : config.markerIds) {
+            ids << QString::number(id);
+        }
+        return ids.join(", ");
+    }
+    case Qt::ToolTipRole:
+        return tr("Type: %1\nMarkers: %2")
+            .arg(QString::fromStdString(config.type), data(index, MarkerIdsRole).toString());
+    default:
+        return QVariant();
+    }
+}
+
+void ConfigurationModel::setConfigurations(
+    const std::map<std::string, Configuration> &configurations)
+{
+    if (countRowChanges(configurations) > MAX_ROW_CHANGES) {
+        beginResetModel();
+        rows.assign(configurations.begin(), configurations.end());
+        endResetModel();
+        return;
+    }
+
+    // Both sides are sorted by key, walk them together
+    size_t row = 0;
+    auto it = configurations.begin();
+    while (row < rows.size() || it != configurations.end()) {
+        if (it == configurations.end() || (row < rows.size() && rows[row].first < it->first)) {
+            size_t last = row;
+            while (last + 1 < rows.size()
+                   && (it == configurations.end() || rows[last + 1].first < it->first)) {
+                last++;
+            }
+            beginRemoveRows(QModelIndex(), (int) row, (int) last);
+            rows.erase(rows.begin() + row, rows.begin() + last + 1);
+            endRemoveRows();
+        } else if (row == rows.size() || it->first < rows[row].first) {
+            auto end = std::next(it);
+            while (end != configurations.end()
+                   && (row == rows.size() || end->first < rows[row].first)) {
+                end++;
+            }
+            size_t count = (size_t) std::distance(it, end);
+            beginInsertRows(QModelIndex(), (int) row, (int) (row + count - 1));
+            rows.insert(rows.begin() + row, it, end);
+            endInsertRows();
+            row += count;
+            it = end;
+        } else {
+            // Rows on both sides, adjacent changed ones are reported together
+            size_t firstChanged = rows.size();
+            while (row < rows.size() && it != configurations.end()
+                   && rows[row].first == it->first) {
+                if (rows[row].second != it->second) {
+                    rows[row].second = it->second;
+                    if (firstChanged == rows.size())
+                        firstChanged = row;
+                } else if (firstChanged != rows.size()) {
+                    emit dataChanged(index((int) firstChanged), index((int) row - 1));
+                    firstChanged = rows.size();
+                }
+                row++;
+                it++;
+            }
+            if (firstChanged != rows.size())
+                emit dataChanged(index((int) firstChanged), index((int) row - 1));
+        }
+    }
+}
+
+size_t ConfigurationModel::countRowChanges(
+    const std::map<std::string, Configuration> &configurations) const
+{
+    size_t changes = 0;
+    size_t row = 0;
+    auto it = configurations.begin();
+    while (row < rows.size() && it != configurations.end()) {
+        if (rows[row].first < it->first) {
+            changes++;
+            row++;
+        } else if (it->first < rows[row].first) {
+            changes++;
+            it++;
+        } else {
+            row++;
+            it++;
+        }
+    }
+    return changes + (rows.size() - row) + (size_t) std::distance(it, configurations.end());
+}
+
+ConfigurationFilterModel::ConfigurationFilterModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+{}
+
+void ConfigurationFilterModel::setSearchText(const QString &text)
+{
+    searchText = text.trimmed();
+    invalidateFilter();
+}
+
+bool ConfigurationFilterModel::filterAcceptsRow(
+    int sourceRow, const QModelIndex &sourceParent) const
+{
+    Q_UNUSED(sourceParent);
+    if (searchText.isEmpty())
+        return true;
+
+    const ConfigurationModel *model = static_cast<const ConfigurationModel *>(sourceModel());
+    const Configuration &config = model->configurationAt(sourceRow);
+    if (QString::fromStdString(config.name).contains(searchText, Qt::CaseInsensitive)
+        || QString::fromStdString(config.type).contains(searchText, Qt::CaseInsensitive))
+        return true;
+
+    bool isNumber = false;
+    int markerId = searchText.toInt(&isNumber);
+    return isNumber
+           && std::find(config.markerIds.begin(), config.markerIds.end(), markerId)
+                  != config.markerIds.end();
+}
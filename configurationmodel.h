@@ -0,0 +1,54 @@
+#ifndef CONFIGURATIONMODEL_H
+#define CONFIGURATIONMODEL_H
+
+#include "yamlhandler.h"
+#include <QAbstractListModel>
+#include <QSortFilterProxyModel>
+
+// Flat list of configurations keyed like the YAML file. setConfigurations()
+// diffs against the current rows and only emits inserts, removals and
+// changes, one per run of adjacent rows, so views keep their scroll position
+// and selection. Larger changes such as an import reset the model instead.
+class ConfigurationModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles { NameRole = Qt::UserRole + 1, TypeRole, MarkerIdsRole };
+
+    explicit ConfigurationModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void setConfigurations(const std::map<std::string, Configuration> &configurations);
+    const Configuration &configurationAt(int row) const { return rows[row].second; }
+
+private:
+    // Above this many inserted and removed rows a reset is cheaper for the
+    // views and the filter model than the single changes
+    static constexpr size_t MAX_ROW_CHANGES = 64;
+
+    // Sorted by key, same order as the map they come from
+    std::vector<std::pair<std::string, Configuration>> rows;
+
+    size_t countRowChanges(const std::map<std::string, Configuration> &configurations) const;
+};
+
+// Matches the search text against name and type, or a marker id when the
+// text is a number
+class ConfigurationFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    explicit ConfigurationFilterModel(QObject *parent = nullptr);
+
+    void setSearchText(const QString &text);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    QString searchText;
+};
+
+#endif // CONFIGURATIONMODEL_H
@@ -0,0 +1,141 @@
+#include "configurationrepository.h"
+#include "configurationstore.h"
+#include <QDebug>
+#include <QFileInfo>
+
+ConfigurationRepository::ConfigurationRepository(
+    YamlHandler *yamlHandler, IoWorker *ioWorker, QObject *parent)
+    : QObject(parent)
+    , yamlHandler(yamlHandler)
+    , ioWorker(ioWorker)
+    , watcher(new QFileSystemWatcher(this))
+    , refreshTimer(new QTimer(this))
+    , current(std::make_shared<const ConfigurationSnapshot>())
+    , knownGeneration(0)
+    , knownEnd(0)
+{
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(100);
+    connect(refreshTimer, &QTimer::timeout, this, &ConfigurationRepository::onFileActivity);
+    connect(watcher, &QFileSystemWatcher::fileChanged, refreshTimer, qOverload<>(&QTimer::start));
+    // Catches the file being created or replaced by a rename
+    connect(
+        watcher, &QFileSystemWatcher::directoryChanged, refreshTimer, qOverload<>(&QTimer::start));
+}
+
+void ConfigurationRepository::open(const std::string &name)
+{
+    fileName = name;
+    QFileInfo info(QString::fromStdString(fileName));
+    watcher->addPath(info.absolutePath());
+    watchFile();
+    ioWorker->post([this]() { refresh(); });
+}
+
+ConfigurationSnapshotPtr ConfigurationRepository::snapshot() const
+{
+    return std::atomic_load(&current);
+}
+
+bool ConfigurationRepository::saveConfiguration(const Configuration &config)
+{
+    ConfigurationSnapshotPtr library = snapshot();
+    bool saved = yamlHandler->updateConfigurations(
+        fileName, library->configurations, library->index, config);
+    refresh();
+    return saved;
+}
+
+bool ConfigurationRepository::removeConfiguration(const Configuration &config)
+{
+    bool removed = yamlHandler->removeConfiguration(fileName, snapshot()->configurations, config);
+    refresh();
+    return removed;
+}
+
+bool ConfigurationRepository::importConfigurations(
+    const std::map<std::string, Configuration> &incomingConfigurations, ImportReport &report)
+{
+    ConfigurationSnapshotPtr library = snapshot();
+    bool imported = yamlHandler->importConfigurations(
+        fileName, library->configurations, library->index, incomingConfigurations, report);
+    refresh();
+    return imported;
+}
+
+void ConfigurationRepository::refresh()
+{
+    QString name = QString::fromStdString(fileName);
+    // Only the segments appended since the last refresh are mapped
+    ConfigurationStore store;
+    if (!store.openSince(name, knownGeneration, knownEnd)) {
+        qWarning() << "Could not read configurations file" << name;
+        return;
+    }
+    if (store.fileGeneration() == knownGeneration && store.journalEnd() == knownEnd)
+        return;
+
+    std::map<std::string, Configuration> configurations;
+    ConfigurationIndex index;
+    if (store.fileGeneration() == knownGeneration && store.journalEnd() > knownEnd) {
+        // Replay only what was appended since the last refresh
+        ConfigurationSnapshotPtr previous = snapshot();
+        configurations = previous->configurations;
+        index = previous->index;
+        for (const ConfigurationView &view : store.changesSince(knownEnd)) {
+            auto existing = configurations.find(std::string(view.name()));
+            if (existing != configurations.end()) {
+                index.erase(existing->second);
+                configurations.erase(existing);
+            }
+            if (!view.isDeleted()) {
+                Configuration config = view.toConfiguration();
+                index.insert(config);
+                configurations.emplace(config.name, std::move(config));
+            }
+        }
+    } else {
+        // Rewritten or truncated, compaction ends up here with unchanged contents
+        if (!store.open(name)) {
+            qWarning() << "Could not read configurations file" << name;
+            return;
+        }
+        store.load(configurations);
+        if (configurations == snapshot()->configurations) {
+            knownGeneration = store.fileGeneration();
+            knownEnd = store.journalEnd();
+            return;
+        }
+        index = ConfigurationIndex(configurations);
+    }
+
+    knownGeneration = store.fileGeneration();
+    knownEnd = store.journalEnd();
+    publish(std::move(configurations), std::move(index));
+}
+
+void ConfigurationRepository::onFileActivity()
+{
+    // Replacing the file drops it from the watcher
+    watchFile();
+    ioWorker->post([this]() { refresh(); });
+}
+
+void ConfigurationRepository::publish(
+    std::map<std::string, Configuration> configurations, ConfigurationIndex index)
+{
+    auto next = std::make_shared<ConfigurationSnapshot>();
+    next->version = snapshot()->version + 1;
+    next->configurations = std::move(configurations);
+    next->index = std::move(index);
+    quint64 version = next->version;
+    std::atomic_store(&current, ConfigurationSnapshotPtr(std::move(next)));
+    emit snapshotChanged(version);
+}
+
+void ConfigurationRepository::watchFile()
+{
+    QString path = QFileInfo(QString::fromStdString(fileName)).absoluteFilePath();
+    if (QFileInfo::exists(path) && !watcher->files().contains(path))
+        watcher->addPath(path);
+}
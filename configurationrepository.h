@@ -0,0 +1,72 @@
+#ifndef CONFIGURATIONREPOSITORY_H
+#define CONFIGURATIONREPOSITORY_H
+
+#include "configurationindex.h"
+#include "ioworker.h"
+#include "yamlhandler.h"
+#include <memory>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QTimer>
+
+// Immutable state of the block library. Every change publishes a new instance
+// with a higher version, holders of an old one are never affected.
+struct ConfigurationSnapshot
+{
+    quint64 version = 0;
+    std::map<std::string, Configuration> configurations;
+    ConfigurationIndex index;
+};
+
+using ConfigurationSnapshotPtr = std::shared_ptr<const ConfigurationSnapshot>;
+
+// The single in-memory copy of the block library. Edits go through it, the
+// tracker and the UI only hold snapshots. Changes to the file, ours or made
+// by another process, are applied by replaying the journal segments appended
+// since the last refresh, the file is read as a whole only after a rewrite.
+// Reading and writing the file happens on the I/O queue.
+class ConfigurationRepository : public QObject
+{
+    Q_OBJECT
+public:
+    ConfigurationRepository(
+        YamlHandler *yamlHandler, IoWorker *ioWorker, QObject *parent = nullptr);
+
+    // Called once on the thread the repository lives in, the first read is queued
+    void open(const std::string &name);
+    // Safe to call from any thread
+    ConfigurationSnapshotPtr snapshot() const;
+
+    // Edits and refresh() must run on the I/O queue
+    bool saveConfiguration(const Configuration &config);
+    bool removeConfiguration(const Configuration &config);
+    bool importConfigurations(
+        const std::map<std::string, Configuration> &incomingConfigurations,
+        ImportReport &report);
+    void refresh();
+
+signals:
+    // Emitted from the I/O queue
+    void snapshotChanged(quint64 version);
+
+private slots:
+    void onFileActivity();
+
+private:
+    YamlHandler *yamlHandler;
+    IoWorker *ioWorker;
+    QFileSystemWatcher *watcher;
+    // Coalesces the bursts of notifications a single write produces
+    QTimer *refreshTimer;
+    std::string fileName;
+
+    ConfigurationSnapshotPtr current;
+    // Position in the journal the current snapshot reflects
+    quint64 knownGeneration;
+    quint64 knownEnd;
+
+    void publish(std::map<std::string, Configuration> configurations, ConfigurationIndex index);
+    void watchFile();
+};
+
+#endif // CONFIGURATIONREPOSITORY_H
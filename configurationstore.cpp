@@ -0,0 +1,683 @@
+#include "configurationstore.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <QFileInfo>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSaveFile>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char STORE_MAGIC[8] = {'Q', 'C', 'C', 'S', 'T', 'O', 'R', 'E'};
+const quint32 STORE_VERSION = 2;
+const quint32 SEGMENT_MAGIC = 0x47455351; // "QSEG"
+
+static_assert(sizeof(store::FileHeader) == 32, "unexpected store header layout");
+static_assert(sizeof(store::SegmentHeader) == 40, "unexpected segment header layout");
+static_assert(sizeof(store::StoredRecord) == 56, "unexpected record layout");
+
+struct SegmentLayout
+{
+    quint64 records;
+    quint64 markerIds;
+    quint64 points;
+    quint64 index;
+    quint64 strings;
+    quint64 size;
+};
+
+SegmentLayout layoutOf(const store::SegmentHeader &header)
+{
+    SegmentLayout layout;
+    layout.records = sizeof(store::SegmentHeader);
+    layout.markerIds = layout.records + quint64(header.recordCount) * sizeof(store::StoredRecord);
+    layout.points = layout.markerIds + quint64(header.markerIdCount) * sizeof(qint32);
+    layout.index = layout.points + quint64(header.pointCount) * sizeof(store::StoredPoint);
+    layout.strings = layout.index + quint64(header.indexCount) * sizeof(store::IndexEntry);
+    // Keep every segment 8 byte aligned
+    layout.size = (layout.strings + header.stringBytes + 7) & ~quint64(7);
+    return layout;
+}
+
+const store::SegmentHeader *segmentHeader(const char *segment)
+{
+    return reinterpret_cast<const store::SegmentHeader *>(segment);
+}
+
+quint32 crc32(const char *data, size_t size, quint32 crc = 0)
+{
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> values;
+        for (quint32 i = 0; i < 256; i++) {
+            quint32 value = i;
+            for (int bit = 0; bit < 8; bit++) {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            values[i] = value;
+        }
+        return values;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ (quint8) data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+quint32 segmentChecksum(const char *segment, quint64 size)
+{
+    store::SegmentHeader header = *segmentHeader(segment);
+    header.checksum = 0;
+    quint32 crc = crc32(reinterpret_cast<const char *>(&header), sizeof(header));
+    return crc32(segment + sizeof(header), size - sizeof(header), crc);
+}
+
+// QFileDevice::flush() only hands data to the OS
+bool syncToDisk(QFileDevice &device)
+{
+    if (!device.flush())
+        return false;
+#ifdef Q_OS_WIN
+    return _commit(device.handle()) == 0;
+#else
+    return fsync(device.handle()) == 0;
+#endif
+}
+
+QMutex &writeMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+// Shared by open stores, exclusive while a writer resizes or replaces the file
+QReadWriteLock &fileLock()
+{
+    static QReadWriteLock lock(QReadWriteLock::Recursive);
+    return lock;
+}
+
+bool isValidHeader(const store::FileHeader &header)
+{
+    return std::memcmp(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC)) == 0
+           && header.version == STORE_VERSION && header.headerSize == sizeof(store::FileHeader);
+}
+
+// Newest journal end of every file up to which the segments have been
+// verified. Appends and readers only look at what lies beyond it.
+struct JournalPosition
+{
+    quint64 generation = 0;
+    quint64 end = 0;
+};
+
+QMutex &positionMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+std::map<QString, JournalPosition> &positions()
+{
+    static std::map<QString, JournalPosition> values;
+    return values;
+}
+
+JournalPosition verifiedPosition(const QString &fileName)
+{
+    QMutexLocker locker(&positionMutex());
+    auto it = positions().find(QFileInfo(fileName).absoluteFilePath());
+    return it == positions().end() ? JournalPosition() : it->second;
+}
+
+void rememberPosition(const QString &fileName, quint64 generation, quint64 end)
+{
+    QMutexLocker locker(&positionMutex());
+    JournalPosition &position = positions()[QFileInfo(fileName).absoluteFilePath()];
+    // Within a generation the journal only grows
+    if (position.generation != generation || position.end < end) {
+        position.generation = generation;
+        position.end = end;
+    }
+}
+
+} // namespace
+
+const qint32 *ConfigurationView::markerIds() const
+{
+    SegmentLayout layout = layoutOf(*segmentHeader(segment));
+    return reinterpret_cast<const qint32 *>(segment + layout.markerIds) + record->firstMarkerId;
+}
+
+std::string_view ConfigurationView::string(const store::StoredString &value) const
+{
+    SegmentLayout layout = layoutOf(*segmentHeader(segment));
+    return std::string_view(segment + layout.strings + value.offset, value.length);
+}
+
+Configuration ConfigurationView::toConfiguration() const
+{
+    Configuration config;
+    config.id = std::string(id());
+    config.name = std::string(name());
+    config.type = std::string(type());
+    config.date = std::string(date());
+    config.markerIds.assign(markerIds(), markerIds() + markerIdCount());
+
+    SegmentLayout layout = layoutOf(*segmentHeader(segment));
+    const store::StoredPoint *points = reinterpret_cast<const store::StoredPoint *>(
+        segment + layout.points);
+    for (quint32 i = record->firstPoint; i < record->firstPoint + record->pointCount; i++) {
+        const store::StoredPoint &point = points[i];
+        config.relativePoints[point.markerId] = cv::Point3f(point.x, point.y, point.z);
+    }
+    return config;
+}
+
+ConfigurationStore::ConfigurationStore()
+    : data(nullptr)
+    , mapOffset(0)
+    , mapEnd(0)
+    , generation(0)
+    , validEnd(0)
+{}
+
+ConfigurationStore::~ConfigurationStore()
+{
+    close();
+}
+
+bool ConfigurationStore::open(const QString &name)
+{
+    if (!openSegments(name))
+        return false;
+    buildLiveRecords();
+    return true;
+}
+
+bool ConfigurationStore::openSegments(const QString &name)
+{
+    return openSince(name, 0, 0);
+}
+
+bool ConfigurationStore::openSince(const QString &name, quint64 knownGeneration, quint64 offset)
+{
+    close();
+    fileName = name;
+    // A crash while creating the file can leave it without a complete header
+    if (QFileInfo(fileName).size() < (qint64) sizeof(store::FileHeader))
+        return true;
+    if (!mapFile(knownGeneration, offset)) {
+        close();
+        return false;
+    }
+    readSegments();
+    return true;
+}
+
+void ConfigurationStore::setFileName(const QString &name)
+{
+    close();
+    fileName = name;
+}
+
+void ConfigurationStore::close()
+{
+    generation = 0;
+    validEnd = 0;
+    liveRecords.clear();
+    liveByName.clear();
+    segmentOffsets.clear();
+    unmapFile();
+}
+
+bool ConfigurationStore::mapFile(quint64 knownGeneration, quint64 offset)
+{
+    // Held until unmapFile(), an open handle alone already blocks a rename
+    fileLock().lockForRead();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    store::FileHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)
+        || !isValidHeader(header))
+        return false;
+    generation = header.generation;
+
+    // The segments before offset are known to the caller when the file was
+    // not rewritten since, they are left unmapped
+    mapEnd = (quint64) file.size();
+    mapOffset = sizeof(store::FileHeader);
+    if (generation == knownGeneration && offset > mapOffset && offset <= mapEnd)
+        mapOffset = offset;
+    if (mapEnd == mapOffset)
+        return true;
+    data = file.map(mapOffset, mapEnd - mapOffset);
+    return data != nullptr;
+}
+
+void ConfigurationStore::unmapFile()
+{
+    if (data) {
+        file.unmap(const_cast<uchar *>(data));
+        data = nullptr;
+    }
+    mapOffset = 0;
+    mapEnd = 0;
+    if (file.isOpen())
+        file.close();
+    if (!file.fileName().isEmpty()) {
+        file.setFileName(QString());
+        fileLock().unlock();
+    }
+}
+
+void ConfigurationStore::readSegments()
+{
+    quint64 offset = mapOffset;
+    while (offset + sizeof(store::SegmentHeader) <= mapEnd) {
+        const char *segment = at(offset);
+        const store::SegmentHeader *segmentInfo = segmentHeader(segment);
+        SegmentLayout layout = layoutOf(*segmentInfo);
+        if (segmentInfo->magic != SEGMENT_MAGIC || segmentInfo->size != layout.size
+            || offset + layout.size > mapEnd)
+            break;
+        segmentOffsets.push_back(offset);
+        offset += layout.size;
+    }
+
+    // Every append is synced before the next one starts and the leftovers of
+    // a torn append are cut off by the next one, so only the last segment
+    // needs its checksum verified, and only once
+    validEnd = mapOffset;
+    if (!segmentOffsets.empty()) {
+        const char *last = at(segmentOffsets.back());
+        quint64 lastEnd = segmentOffsets.back() + segmentHeader(last)->size;
+        JournalPosition verified = verifiedPosition(fileName);
+        bool known = verified.generation == generation && verified.end >= lastEnd;
+        if (!known && segmentChecksum(last, lastEnd - segmentOffsets.back())
+                          != segmentHeader(last)->checksum)
+            segmentOffsets.pop_back();
+    }
+    if (!segmentOffsets.empty())
+        validEnd = segmentOffsets.back() + segmentHeader(at(segmentOffsets.back()))->size;
+    rememberPosition(fileName, generation, validEnd);
+
+    // Newest first
+    std::reverse(segmentOffsets.begin(), segmentOffsets.end());
+}
+
+void ConfigurationStore::buildLiveRecords()
+{
+    // The newest record of every name wins, tombstones included
+    std::unordered_map<std::string_view, ConfigurationView> newest;
+    for (quint64 offset : segmentOffsets) {
+        const char *segment = at(offset);
+        SegmentLayout layout = layoutOf(*segmentHeader(segment));
+        const store::StoredRecord *records = reinterpret_cast<const store::StoredRecord *>(
+            segment + layout.records);
+        for (quint32 i = segmentHeader(segment)->recordCount; i-- > 0;) {
+            ConfigurationView view;
+            view.segment = segment;
+            view.record = &records[i];
+            newest.emplace(view.name(), view);
+        }
+    }
+
+    for (const auto &entry : newest) {
+        if (!entry.second.isDeleted())
+            liveRecords.push_back(entry.second);
+    }
+    std::sort(
+        liveRecords.begin(),
+        liveRecords.end(),
+        [](const ConfigurationView &a, const ConfigurationView &b) { return a.name() < b.name(); });
+    for (size_t i = 0; i < liveRecords.size(); i++) {
+        liveByName.emplace(liveRecords[i].name(), i);
+    }
+}
+
+ConfigurationView ConfigurationStore::findByName(std::string_view name) const
+{
+    auto it = liveByName.find(name);
+    return it == liveByName.end() ? ConfigurationView() : liveRecords[it->second];
+}
+
+ConfigurationView ConfigurationStore::findByMarkerId(int markerId) const
+{
+    for (quint64 offset : segmentOffsets) {
+        const char *segment = at(offset);
+        const store::SegmentHeader *header = segmentHeader(segment);
+        SegmentLayout layout = layoutOf(*header);
+        const store::IndexEntry *index = reinterpret_cast<const store::IndexEntry *>(
+            segment + layout.index);
+        const store::StoredRecord *records = reinterpret_cast<const store::StoredRecord *>(
+            segment + layout.records);
+
+        auto range = std::equal_range(
+            index,
+            index + header->indexCount,
+            store::IndexEntry{markerId, 0},
+            [](const store::IndexEntry &a, const store::IndexEntry &b) {
+                return a.markerId < b.markerId;
+            });
+        for (auto it = range.first; it != range.second; it++) {
+            // Only records that are still the live version of their block count
+            const store::StoredRecord *record = &records[it->record];
+            ConfigurationView view;
+            view.segment = segment;
+            view.record = record;
+            ConfigurationView live = findByName(view.name());
+            if (live.record == record)
+                return live;
+        }
+    }
+    return ConfigurationView();
+}
+
+std::vector<ConfigurationView> ConfigurationStore::changesSince(quint64 offset) const
+{
+    std::vector<ConfigurationView> changes;
+    for (auto it = segmentOffsets.rbegin(); it != segmentOffsets.rend(); ++it) {
+        if (*it < offset)
+            continue;
+        const char *segment = at(*it);
+        const store::SegmentHeader *header = segmentHeader(segment);
+        const store::StoredRecord *records = reinterpret_cast<const store::StoredRecord *>(
+            segment + layoutOf(*header).records);
+        for (quint32 i = 0; i < header->recordCount; i++) {
+            ConfigurationView view;
+            view.segment = segment;
+            view.record = &records[i];
+            changes.push_back(view);
+        }
+    }
+    return changes;
+}
+
+void ConfigurationStore::load(std::map<std::string, Configuration> &configurations) const
+{
+    for (const ConfigurationView &view : liveRecords) {
+        configurations.emplace_hint(
+            configurations.end(), std::string(view.name()), view.toConfiguration());
+    }
+}
+
+bool ConfigurationStore::append(
+    const std::vector<Configuration> &configurations, const std::vector<std::string> &removedNames)
+{
+    if (configurations.empty() && removedNames.empty())
+        return true;
+
+    // The views would not survive the write, what is known about the file does
+    QString name = fileName;
+    quint64 knownGeneration = generation;
+    quint64 knownEnd = validEnd;
+    setFileName(name);
+
+    QMutexLocker locker(&writeMutex());
+    QFile output(name);
+    if (!output.open(QIODevice::ReadWrite))
+        return false;
+    quint64 offset = 0;
+    if (!findJournalEnd(output, knownGeneration, knownEnd, offset))
+        return false;
+
+    QByteArray bytes;
+    if (offset == 0) {
+        generation = 1;
+        bytes = buildHeader(generation);
+    }
+    bytes += buildSegment(configurations, removedNames);
+    // Cut off what a torn append may have left behind
+    QWriteLocker fileLocker(&fileLock());
+    bool written = output.resize(offset) && output.seek(offset)
+                   && output.write(bytes) == bytes.size() && syncToDisk(output);
+    output.close();
+    fileLocker.unlock();
+
+    if (!written) {
+        generation = 0;
+        return false;
+    }
+    validEnd = offset + bytes.size();
+    rememberPosition(name, generation, validEnd);
+    return true;
+}
+
+bool ConfigurationStore::findJournalEnd(
+    QFile &output, quint64 knownGeneration, quint64 knownEnd, quint64 &end)
+{
+    // Without a complete header the file is started over
+    end = 0;
+    quint64 size = (quint64) output.size();
+    if (size < sizeof(store::FileHeader))
+        return true;
+    store::FileHeader header;
+    if (output.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)
+        || !isValidHeader(header))
+        return false;
+    generation = header.generation;
+
+    // Another writer may have appended or rewritten the file meanwhile. Only
+    // the segments behind the furthest verified end are read.
+    quint64 offset = sizeof(store::FileHeader);
+    if (generation == knownGeneration && knownEnd > offset && knownEnd <= size)
+        offset = knownEnd;
+    JournalPosition verified = verifiedPosition(fileName);
+    if (verified.generation == generation && verified.end > offset && verified.end <= size)
+        offset = verified.end;
+
+    quint64 last = offset;
+    store::SegmentHeader segment;
+    while (offset + sizeof(segment) <= size && output.seek(offset)
+           && output.read(reinterpret_cast<char *>(&segment), sizeof(segment)) == sizeof(segment)) {
+        SegmentLayout layout = layoutOf(segment);
+        if (segment.magic != SEGMENT_MAGIC || segment.size != layout.size
+            || offset + layout.size > size)
+            break;
+        last = offset;
+        offset += layout.size;
+    }
+    if (offset > last) {
+        QByteArray bytes;
+        if (output.seek(last))
+            bytes = output.read((qint64) (offset - last));
+        if ((quint64) bytes.size() != offset - last
+            || segmentChecksum(bytes.constData(), bytes.size())
+                   != segmentHeader(bytes.constData())->checksum)
+            offset = last;
+    }
+    end = offset;
+    return true;
+}
+
+bool ConfigurationStore::rewrite(const std::map<std::string, Configuration> &configurations)
+{
+    std::vector<Configuration> records;
+    records.reserve(configurations.size());
+    for (const auto &entry : configurations) {
+        records.push_back(entry.second);
+    }
+
+    QString name = fileName;
+    setFileName(name);
+
+    QMutexLocker locker(&writeMutex());
+    // Only the generation of the old file matters
+    quint64 nextGeneration = 1;
+    QFile old(name);
+    store::FileHeader header;
+    if (old.open(QIODevice::ReadOnly)
+        && old.read(reinterpret_cast<char *>(&header), sizeof(header)) == sizeof(header)
+        && isValidHeader(header))
+        nextGeneration = header.generation + 1;
+    old.close();
+
+    QSaveFile output(name);
+    if (!output.open(QIODevice::WriteOnly))
+        return false;
+    QByteArray bytes = buildHeader(nextGeneration);
+    bytes += buildSegment(records, {});
+    bool committed = output.write(bytes) == bytes.size() && syncToDisk(output);
+    {
+        QWriteLocker fileLocker(&fileLock());
+        committed = committed && output.commit();
+    }
+    if (!committed)
+        return false;
+
+    generation = nextGeneration;
+    validEnd = bytes.size();
+    rememberPosition(name, generation, validEnd);
+    return true;
+}
+
+bool ConfigurationStore::compact(const QString &fileName)
+{
+    // The snapshot is built without holding the write lock
+    ConfigurationStore source;
+    if (!source.open(fileName))
+        return false;
+    if (source.segmentCount() <= 1)
+        return true;
+    quint64 sourceGeneration = source.generation;
+    quint64 sourceEnd = source.validEnd;
+    std::map<std::string, Configuration> configurations;
+    source.load(configurations);
+    source.close();
+
+    std::vector<Configuration> records;
+    records.reserve(configurations.size());
+    for (const auto &entry : configurations) {
+        records.push_back(entry.second);
+    }
+    QByteArray snapshot = buildHeader(sourceGeneration + 1);
+    snapshot += buildSegment(records, {});
+
+    QMutexLocker locker(&writeMutex());
+    ConfigurationStore current;
+    if (!current.openSince(fileName, sourceGeneration, sourceEnd)
+        || current.generation != sourceGeneration)
+        return false; // Rewritten by someone else meanwhile
+    quint64 currentEnd = current.validEnd;
+    QByteArray tail;
+    if (currentEnd > sourceEnd)
+        tail = QByteArray(current.at(sourceEnd), (int) (currentEnd - sourceEnd));
+    current.close();
+
+    QSaveFile output(fileName);
+    if (!output.open(QIODevice::WriteOnly))
+        return false;
+    output.write(snapshot);
+    output.write(tail);
+    if (!syncToDisk(output))
+        return false;
+    {
+        QWriteLocker fileLocker(&fileLock());
+        if (!output.commit())
+            return false;
+    }
+    rememberPosition(fileName, sourceGeneration + 1, snapshot.size() + tail.size());
+    return true;
+}
+
+bool ConfigurationStore::isStoreFile(const std::string &fileName)
+{
+    return QString::fromStdString(fileName).endsWith(".bin", Qt::CaseInsensitive);
+}
+
+QByteArray ConfigurationStore::buildHeader(quint64 fileGeneration)
+{
+    store::FileHeader header{};
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    header.version = STORE_VERSION;
+    header.headerSize = sizeof(store::FileHeader);
+    header.generation = fileGeneration;
+    return QByteArray(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+QByteArray ConfigurationStore::buildSegment(
+    const std::vector<Configuration> &configurations,
+    const std::vector<std::string> &removedNames)
+{
+    std::vector<store::StoredRecord> records;
+    std::vector<qint32> markerIds;
+    std::vector<store::StoredPoint> points;
+    std::vector<store::IndexEntry> index;
+    std::string strings;
+
+    auto addString = [&strings](const std::string &value) {
+        store::StoredString stored{(quint32) strings.size(), (quint32) value.size()};
+        strings += value;
+        return stored;
+    };
+
+    // Tombstones go first, a block removed and added again by the same change
+    // then survives, as later records of a name win
+    for (const std::string &name : removedNames) {
+        store::StoredRecord record{};
+        record.flags = store::Deleted;
+        record.name = addString(name);
+        records.push_back(record);
+    }
+    for (const Configuration &config : configurations) {
+        store::StoredRecord record{};
+        record.id = addString(config.id);
+        record.name = addString(config.name);
+        record.type = addString(config.type);
+        record.date = addString(config.date);
+        record.firstMarkerId = (quint32) markerIds.size();
+        record.markerIdCount = (quint32) config.markerIds.size();
+        record.firstPoint = (quint32) points.size();
+        record.pointCount = (quint32) config.relativePoints.size();
+        for (int markerId : config.markerIds) {
+            markerIds.push_back(markerId);
+            index.push_back(store::IndexEntry{markerId, (quint32) records.size()});
+        }
+        for (const auto &point : config.relativePoints) {
+            points.push_back(
+                store::StoredPoint{point.first, point.second.x, point.second.y, point.second.z});
+        }
+        records.push_back(record);
+    }
+    std::sort(
+        index.begin(), index.end(), [](const store::IndexEntry &a, const store::IndexEntry &b) {
+            return a.markerId < b.markerId;
+        });
+
+    store::SegmentHeader header{};
+    header.magic = SEGMENT_MAGIC;
+    header.recordCount = (quint32) records.size();
+    header.markerIdCount = (quint32) markerIds.size();
+    header.pointCount = (quint32) points.size();
+    header.indexCount = (quint32) index.size();
+    header.stringBytes = (quint32) strings.size();
+    SegmentLayout layout = layoutOf(header);
+    header.size = layout.size;
+
+    QByteArray segment((int) layout.size, '\0');
+    auto copy = [&segment](quint64 offset, const void *source, size_t bytes) {
+        if (bytes > 0)
+            std::memcpy(segment.data() + offset, source, bytes);
+    };
+    copy(0, &header, sizeof(header));
+    copy(layout.records, records.data(), records.size() * sizeof(store::StoredRecord));
+    copy(layout.markerIds, markerIds.data(), markerIds.size() * sizeof(qint32));
+    copy(layout.points, points.data(), points.size() * sizeof(store::StoredPoint));
+    copy(layout.index, index.data(), index.size() * sizeof(store::IndexEntry));
+    copy(layout.strings, strings.data(), strings.size());
+
+    quint32 checksum = segmentChecksum(segment.constData(), layout.size);
+    char *checksumField = segment.data() + offsetof(store::SegmentHeader, checksum);
+    std::memcpy(checksumField, &checksum, sizeof(checksum));
+    return segment;
+}
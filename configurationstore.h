@@ -0,0 +1,205 @@
+#ifndef CONFIGURATIONSTORE_H
+#define CONFIGURATIONSTORE_H
+
+#include "yamlhandler.h"
+#include <QFile>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// On-disk layout. The file starts with a FileHeader followed by segments
+// back to back, every segment holds fixed-size records, the marker ids and
+// relative points they reference, a marker id index sorted by id and a string
+// table. The segments form a journal: every change appends one segment and
+// compaction rewrites the file as a single one. Records in newer segments
+// replace records with the same name in older ones, as do later records in
+// the same segment. Deleted blocks are stored as tombstones ahead of the
+// records of their segment. Only the last segment can be incomplete after a
+// crash, its checksum tells and it is then dropped.
+namespace store {
+
+struct FileHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 headerSize;
+    // Incremented every time the file is rewritten as a whole
+    quint64 generation;
+    quint64 reserved;
+};
+
+struct SegmentHeader
+{
+    quint32 magic;
+    quint32 recordCount;
+    quint32 markerIdCount;
+    quint32 pointCount;
+    quint32 indexCount;
+    quint32 stringBytes;
+    // CRC-32 of the whole segment with this field set to zero
+    quint32 checksum;
+    quint32 reserved;
+    quint64 size;
+};
+
+struct StoredString
+{
+    quint32 offset;
+    quint32 length;
+};
+
+struct StoredRecord
+{
+    quint32 flags;
+    StoredString id;
+    StoredString name;
+    StoredString type;
+    StoredString date;
+    quint32 firstMarkerId;
+    quint32 markerIdCount;
+    quint32 firstPoint;
+    quint32 pointCount;
+    quint32 reserved;
+};
+
+struct StoredPoint
+{
+    qint32 markerId;
+    float x;
+    float y;
+    float z;
+};
+
+struct IndexEntry
+{
+    qint32 markerId;
+    quint32 record;
+};
+
+enum RecordFlags : quint32 { Deleted = 1 };
+
+} // namespace store
+
+// Read-only view of one record inside the mapped file. Valid until the store
+// it came from is written to or closed.
+class ConfigurationView
+{
+public:
+    ConfigurationView()
+        : segment(nullptr)
+        , record(nullptr)
+    {}
+
+    bool isValid() const { return record != nullptr; }
+    bool isDeleted() const { return record->flags & store::Deleted; }
+
+    std::string_view id() const { return string(record->id); }
+    std::string_view name() const { return string(record->name); }
+    std::string_view type() const { return string(record->type); }
+    std::string_view date() const { return string(record->date); }
+    const qint32 *markerIds() const;
+    size_t markerIdCount() const { return record->markerIdCount; }
+
+    Configuration toConfiguration() const;
+
+private:
+    friend class ConfigurationStore;
+
+    const char *segment;
+    const store::StoredRecord *record;
+
+    std::string_view string(const store::StoredString &value) const;
+};
+
+// Binary configuration library. Reads map the file and never copy records,
+// single block changes are appended to the journal with one fsync instead of
+// rewriting the file. YAML stays the format for import and export.
+// Writers in the process are serialized. Windows cannot resize or replace a
+// mapped file, so a write waits until no store of the process has it open and
+// stores opened meanwhile wait for the write. Stores are kept open only for
+// the duration of a read.
+class ConfigurationStore
+{
+public:
+    ConfigurationStore();
+    ~ConfigurationStore();
+
+    // Maps an existing store, a missing file opens as an empty store
+    bool open(const QString &fileName);
+    // Maps the file and finds its segments without indexing the records,
+    // enough for journalEnd() and changesSince()
+    bool openSegments(const QString &name);
+    // Like openSegments() but maps only what follows offset when the file
+    // still has the given generation, all of it otherwise
+    bool openSince(const QString &name, quint64 knownGeneration, quint64 offset);
+    // Targets a file for append() or rewrite() without reading it
+    void setFileName(const QString &name);
+    void close();
+
+    // Live records sorted by name
+    const std::vector<ConfigurationView> &records() const { return liveRecords; }
+    ConfigurationView findByName(std::string_view name) const;
+    ConfigurationView findByMarkerId(int markerId) const;
+    size_t segmentCount() const { return segmentOffsets.size(); }
+    bool needsCompaction() const { return segmentOffsets.size() > MAX_JOURNAL_SEGMENTS; }
+    quint64 fileGeneration() const { return generation; }
+    quint64 journalEnd() const { return validEnd; }
+
+    // Records of the segments starting at or after offset, oldest first and
+    // tombstones included. Lets readers replay only what was appended.
+    std::vector<ConfigurationView> changesSince(quint64 offset) const;
+
+    void load(std::map<std::string, Configuration> &configurations) const;
+
+    // Appends one segment with the given blocks and tombstones. Reads only the
+    // file header and the segments behind the end known from the last open or
+    // write, the store is left closed with journalEnd() past the new segment.
+    // Must not be called while another store is open on the same thread.
+    bool append(
+        const std::vector<Configuration> &configurations,
+        const std::vector<std::string> &removedNames = {});
+    // Replaces the file with a single segment holding exactly these blocks,
+    // the store is left closed
+    bool rewrite(const std::map<std::string, Configuration> &configurations);
+
+    // Folds the journal into one segment through a temporary file and an
+    // atomic rename. Changes appended meanwhile are carried over, so it is
+    // safe to run on a background thread.
+    static bool compact(const QString &fileName);
+    static bool isStoreFile(const std::string &fileName);
+
+private:
+    static constexpr size_t MAX_JOURNAL_SEGMENTS = 32;
+
+    QString fileName;
+    QFile file;
+    const uchar *data;
+    // File range that is mapped to data
+    quint64 mapOffset;
+    quint64 mapEnd;
+    quint64 generation;
+    // End of the last complete segment, appends start here
+    quint64 validEnd;
+
+    // Newest segment first
+    std::vector<quint64> segmentOffsets;
+    std::vector<ConfigurationView> liveRecords;
+    std::unordered_map<std::string_view, size_t> liveByName;
+
+    const char *at(quint64 offset) const
+    {
+        return reinterpret_cast<const char *>(data) + (offset - mapOffset);
+    }
+    bool mapFile(quint64 knownGeneration, quint64 offset);
+    void unmapFile();
+    void readSegments();
+    bool findJournalEnd(QFile &output, quint64 knownGeneration, quint64 knownEnd, quint64 &end);
+    void buildLiveRecords();
+
+    static QByteArray buildSegment(
+        const std::vector<Configuration> &configurations,
+        const std::vector<std::string> &removedNames);
+    static QByteArray buildHeader(quint64 fileGeneration);
+};
+
+#endif // CONFIGURATIONSTORE_H
@@ -1,5 +1,4 @@
 #include "configurationswidget.h"
-#include "section.h"
 #include <QDateTime>
 
 ConfigurationForm::ConfigurationForm(QWidget *parent)
@@ -67,60 +66,103 @@ void ConfigurationForm::onDeleteButton()
 
 ConfigurationsWidget::ConfigurationsWidget(QWidget *parent)
     : QWidget(parent)
-{}
+    , model(new ConfigurationModel(this))
+    , filterModel(new ConfigurationFilterModel(this))
+    , currentRemoved(false)
+{
+    filterModel->setSourceModel(model);
+
+    searchInput = new QLineEdit(this);
+    searchInput->setPlaceholderText(tr("Search by name, type or marker ID"));
+    searchInput->setClearButtonEnabled(true);
+    connect(searchInput, &QLineEdit::textChanged, filterModel, [this](const QString &text) {
+        filterModel->setSearchText(text);
+    });
+
+    listView = new QListView(this);
+    listView->setModel(filterModel);
+    listView->setUniformItemSizes(true);
+    listView->setSelectionMode(QAbstractItemView::SingleSelection);
+    listView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    connect(
+        listView->selectionModel(),
+        &QItemSelectionModel::currentChanged,
+        this,
+        &ConfigurationsWidget::updateForm);
+    // Keep the editor in sync when the selected block changes or disappears.
+    // Changes to other blocks leave the form, and what is typed in it, alone.
+    connect(
+        model,
+        &QAbstractItemModel::dataChanged,
+        this,
+        [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+            int row = currentRow();
+            if (row >= topLeft.row() && row <= bottomRight.row())
+                updateForm();
+        });
+    connect(
+        model,
+        &QAbstractItemModel::rowsAboutToBeRemoved,
+        this,
+        [this](const QModelIndex &, int first, int last) {
+            int row = currentRow();
+            currentRemoved = row >= first && row <= last;
+        });
+    connect(model, &QAbstractItemModel::rowsRemoved, this, [this]() {
+        if (currentRemoved)
+            updateForm();
+        currentRemoved = false;
+    });
+    connect(filterModel, &QAbstractItemModel::layoutChanged, this, [this]() {
+        if (currentRow() < 0)
+            updateForm();
+    });
+
+    emptyLabel = new QLabel(tr("Configuration file is empty or missing"), this);
+
+    form = new ConfigurationForm(this);
+    form->hide();
+    connect(
+        form,
+        &ConfigurationForm::editConfiguration,
+        this,
+        &ConfigurationsWidget::editConfiguration);
+    connect(
+        form,
+        &ConfigurationForm::removeConfiguration,
+        this,
+        &ConfigurationsWidget::removeConfiguration);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->addWidget(searchInput);
+    mainLayout->addWidget(emptyLabel);
+    mainLayout->addWidget(listView, 1);
+    mainLayout->addWidget(form);
+    setLayout(mainLayout);
+}
 
 void ConfigurationsWidget::setConfigurations(
     const std::map<std::string, Configuration> &configurations)
 {
-    QVBoxLayout *mainLayout = qobject_cast<QVBoxLayout *>(this->layout());
-
-    if (!mainLayout) {
-        mainLayout = new QVBoxLayout(this);
-    } else {
-        clearLayout(mainLayout);
-    }
-
-    if (configurations.empty()) {
-        QLabel *messageLabel = new QLabel(tr("Configuration file is empty or missing"));
-        mainLayout->addWidget(messageLabel);
-    } else {
-        for (const auto &pair : configurations) {
-            Section *section = new Section(pair.second.name.c_str(), 300, this);
-            QVBoxLayout *contentLayout = new QVBoxLayout();
-            ConfigurationForm *widget = new ConfigurationForm();
-            widget->setData(pair.second);
-            connect(
-                widget,
-                &ConfigurationForm::editConfiguration,
-                this,
-                &ConfigurationsWidget::editConfiguration);
-            connect(
-                widget,
-                &ConfigurationForm::removeConfiguration,
-                this,
-                &ConfigurationsWidget::removeConfiguration);
-            contentLayout->addWidget(widget);
-            section->setContentLayout(*contentLayout);
-            mainLayout->addWidget(section);
-        }
-        mainLayout->addStretch(1);
-    }
-    if (!this->layout()) {
-        this->setLayout(mainLayout);
-    }
+    model->setConfigurations(configurations);
+    emptyLabel->setVisible(configurations.empty());
+    if (currentRow() < 0)
+        updateForm();
 }
 
-void ConfigurationsWidget::clearLayout(QLayout *layout)
+int ConfigurationsWidget::currentRow() const
 {
-    Q_ASSERT(layout != nullptr);
-
-    while (QLayoutItem *item = layout->takeAt(0)) {
-        QWidget *widget = item->widget();
+    QModelIndex current = listView->currentIndex();
+    return current.isValid() ? filterModel->mapToSource(current).row() : -1;
+}
 
-        if (widget) {
-            delete widget;
-        } else {
-            delete item;
-        }
+void ConfigurationsWidget::updateForm()
+{
+    QModelIndex current = listView->currentIndex();
+    if (!current.isValid()) {
+        form->hide();
+        return;
     }
+    form->setData(model->configurationAt(filterModel->mapToSource(current).row()));
+    form->show();
 }
@@ -1,12 +1,13 @@
 #ifndef CONFIGURATIONSWIDGET_H
 #define CONFIGURATIONSWIDGET_H
 
+#include "configurationmodel.h"
 #include "yamlhandler.h"
 #include <QFormLayout>
 #include <QLabel>
 #include <QLineEdit>
+#include <QListView>
 #include <QPushButton>
-#include <QStackedWidget>
 #include <QWidget>
 
 class ConfigurationForm : public QWidget
@@ -56,7 +57,19 @@ signals:
     void removeConfiguration(const Configuration &config);
 
 private:
-    void clearLayout(QLayout *layout);
+    ConfigurationModel *model;
+    ConfigurationFilterModel *filterModel;
+    QLineEdit *searchInput;
+    QListView *listView;
+    QLabel *emptyLabel;
+    // Single editor, filled from the selected row
+    ConfigurationForm *form;
+    // The selected row is being removed from the model
+    bool currentRemoved;
+
+    // Source model row of the selected block, -1 without one
+    int currentRow() const;
+    void updateForm();
 };
 
 #endif // CONFIGURATIONSWIDGET_H
@@ -0,0 +1,174 @@
+#include "detectionpipeline.h"
+#include "latencymetrics.h"
+
+DetectionPipeline::DetectionPipeline()
+    : nextSequence(0)
+    , markerSize(0.0f)
+{
+    setWorkers(1);
+}
+
+DetectionPipeline::~DetectionPipeline()
+{
+    drain();
+}
+
+void DetectionPipeline::setWorkers(int count)
+{
+    count = qBound(1, count, MAX_WORKERS);
+    if (count == workers())
+        return;
+
+    drain();
+    while (workers() > count) {
+        detectors.pop_back();
+    }
+    while (workers() < count) {
+        detectors.push_back(std::make_unique<MarkerDetector>());
+        configure(*detectors.back());
+    }
+    freeDetectors.clear();
+    for (int i = workers() - 1; i >= 0; i--) {
+        freeDetectors.push_back(i);
+    }
+}
+
+void DetectionPipeline::setDetectorSettings(const DetectorSettings &newSettings)
+{
+    drain();
+    settings = newSettings;
+    for (auto &detector : detectors) {
+        detector->setDetectorSettings(settings);
+    }
+}
+
+void DetectionPipeline::setKnownMarkerIds(const std::vector<int> &ids)
+{
+    drain();
+    knownMarkerIds = ids;
+    for (auto &detector : detectors) {
+        detector->setKnownMarkerIds(knownMarkerIds);
+    }
+}
+
+void DetectionPipeline::setMarkerSize(float size)
+{
+    drain();
+    markerSize = size;
+    for (auto &detector : detectors) {
+        detector->setMarkerSize(markerSize);
+    }
+}
+
+void DetectionPipeline::setCalibrationParams(const CalibrationParams &params)
+{
+    drain();
+    calibrationParams = params;
+    for (auto &detector : detectors) {
+        detector->setCalibrationParams(calibrationParams);
+    }
+}
+
+void DetectionPipeline::submit(const cv::Mat &image, qint64 captureTime, const CameraFrame &frame)
+{
+    auto job = std::make_shared<DetectionJob>();
+    job->sequence = nextSequence++;
+    job->captureTime = captureTime;
+    job->image = image;
+    job->frame = frame;
+
+    if (workers() == 1) {
+        run(*detectors[0], *job);
+        finished.push_back(std::move(job));
+        return;
+    }
+
+    // Skipped frames ahead of the oldest running one free no detector
+    while (freeDetectors.empty())
+        retireOldest();
+    Slot slot;
+    slot.detector = freeDetectors.back();
+    freeDetectors.pop_back();
+    slot.job = job;
+    MarkerDetector *detector = detectors[slot.detector].get();
+    slot.handle = TaskExecutor::instance().submit(
+        [detector, job](const CancellationToken &) { run(*detector, *job); }, TaskPriority::High);
+    inFlight.push_back(std::move(slot));
+}
+
+void DetectionPipeline::skip(qint64 captureTime, const CameraFrame &frame)
+{
+    auto job = std::make_shared<DetectionJob>();
+    job->sequence = nextSequence++;
+    job->captureTime = captureTime;
+    job->frame = frame;
+    job->skipped = true;
+
+    if (inFlight.empty()) {
+        finished.push_back(std::move(job));
+        return;
+    }
+    // Waits behind the frames in flight, its empty handle never runs
+    Slot slot;
+    slot.detector = -1;
+    slot.job = std::move(job);
+    inFlight.push_back(std::move(slot));
+}
+
+bool DetectionPipeline::takeFinished(DetectionJob &job)
+{
+    if (finished.empty() && !inFlight.empty() && !inFlight.front().handle.isRunning())
+        retireOldest();
+    if (finished.empty())
+        return false;
+
+    job = std::move(*finished.front());
+    finished.pop_front();
+    return true;
+}
+
+bool DetectionPipeline::waitFinished(DetectionJob &job)
+{
+    if (finished.empty() && !inFlight.empty())
+        retireOldest();
+    return takeFinished(job);
+}
+
+void DetectionPipeline::drain()
+{
+    while (!inFlight.empty()) {
+        retireOldest();
+    }
+    finished.clear();
+}
+
+void DetectionPipeline::configure(MarkerDetector &detector) const
+{
+    detector.setDetectorSettings(settings);
+    detector.setKnownMarkerIds(knownMarkerIds);
+    if (markerSize > 0.0f)
+        detector.setMarkerSize(markerSize);
+    if (!calibrationParams.cameraMatrix.empty())
+        detector.setCalibrationParams(calibrationParams);
+}
+
+void DetectionPipeline::retireOldest()
+{
+    Slot &oldest = inFlight.front();
+    oldest.handle.wait();
+    if (oldest.detector >= 0)
+        freeDetectors.push_back(oldest.detector);
+    finished.push_back(std::move(oldest.job));
+    inFlight.pop_front();
+}
+
+void DetectionPipeline::run(MarkerDetector &detector, DetectionJob &job)
+{
+    job.detectStart = LatencyMetrics::now();
+    detector.detect(job.image, job.detections);
+    job.detectEnd = LatencyMetrics::now();
+    if (!job.detections.markerIds.empty()) {
+        ScopedStageTimer timer(Stage::Pose);
+        detector.estimatePoses(job.detections);
+    }
+}
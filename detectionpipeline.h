@@ -0,0 +1,85 @@
+#ifndef DETECTIONPIPELINE_H
+#define DETECTIONPIPELINE_H
+
+#include "cameraframe.h"
+#include "markerdetector.h"
+#include "taskexecutor.h"
+#include <deque>
+#include <memory>
+
+// Detection and pose estimation of one frame, the part of tracking that
+// does not depend on earlier frames
+struct DetectionJob
+{
+    quint64 sequence = 0;
+    // When the frame was read, for end-to-end latency
+    qint64 captureTime = 0;
+    cv::Mat image;
+    // Frame the image was made from, kept for display
+    CameraFrame frame;
+    // Passed through without detection, detections stay empty
+    bool skipped = false;
+    MarkerDetections detections;
+    qint64 detectStart = 0;
+    qint64 detectEnd = 0;
+};
+
+// Runs detection of consecutive frames on up to K pool workers at once and
+// hands the results back in capture order. Every frame in flight has a
+// detector of its own. With one worker frames are processed inline.
+// Owned by a single thread; changing the detectors waits for the frames in
+// flight and drops them, their results would not match the new settings.
+class DetectionPipeline
+{
+public:
+    static constexpr int MAX_WORKERS = 16;
+
+    DetectionPipeline();
+    ~DetectionPipeline();
+
+    void setWorkers(int count);
+    int workers() const { return (int) detectors.size(); }
+
+    void setDetectorSettings(const DetectorSettings &settings);
+    void setKnownMarkerIds(const std::vector<int> &ids);
+    void setMarkerSize(float size);
+    void setCalibrationParams(const CalibrationParams &params);
+
+    // Blocks only while every worker is busy, then waits for the oldest frame
+    void submit(const cv::Mat &image, qint64 captureTime, const CameraFrame &frame = {});
+    // Queues a frame that is not detected, it comes out in order with the others
+    void skip(qint64 captureTime, const CameraFrame &frame);
+    // Next finished frame in capture order, false when the oldest is still running
+    bool takeFinished(DetectionJob &job);
+    // Like takeFinished() but waits for the oldest frame, false when none is left
+    bool waitFinished(DetectionJob &job);
+    // Waits for the frames in flight and drops them
+    void drain();
+
+private:
+    struct Slot
+    {
+        std::shared_ptr<DetectionJob> job;
+        TaskHandle handle;
+        // -1 for skipped frames, they hold no detector
+        int detector;
+    };
+
+    std::vector<std::unique_ptr<MarkerDetector>> detectors;
+    std::vector<int> freeDetectors;
+    std::deque<Slot> inFlight;
+    std::deque<std::shared_ptr<DetectionJob>> finished;
+    quint64 nextSequence;
+
+    // Detector state, replayed onto detectors created later
+    DetectorSettings settings;
+    std::vector<int> knownMarkerIds;
+    float markerSize;
+    CalibrationParams calibrationParams;
+
+    void configure(MarkerDetector &detector) const;
+    void retireOldest();
+    static void run(MarkerDetector &detector, DetectionJob &job);
+};
+
+#endif // DETECTIONPIPELINE_H
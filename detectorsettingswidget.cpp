@@ -0,0 +1,214 @@
+#include "detectorsettingswidget.h"
+#include "detectionpipeline.h"
+#include <QFileDialog>
+#include <QHBoxLayout>
+
+DetectorSettingsWidget::DetectorSettingsWidget(QWidget *parent)
+    : QWidget(parent)
+    , averageDetectMs(0.0)
+    , averageSharpness(0.0)
+    , updating(false)
+{
+    winSizeMinInput = new QSpinBox(this);
+    winSizeMinInput->setRange(3, 99);
+    winSizeMaxInput = new QSpinBox(this);
+    winSizeMaxInput->setRange(3, 99);
+    winSizeStepInput = new QSpinBox(this);
+    winSizeStepInput->setRange(1, 99);
+
+    threshConstantInput = new QDoubleSpinBox(this);
+    threshConstantInput->setRange(0.0, 50.0);
+    threshConstantInput->setSingleStep(1.0);
+
+    minPerimeterRateInput = new QDoubleSpinBox(this);
+    minPerimeterRateInput->setDecimals(3);
+    minPerimeterRateInput->setRange(0.001, 4.0);
+    minPerimeterRateInput->setSingleStep(0.01);
+    maxPerimeterRateInput = new QDoubleSpinBox(this);
+    maxPerimeterRateInput->setDecimals(3);
+    maxPerimeterRateInput->setRange(0.01, 8.0);
+    maxPerimeterRateInput->setSingleStep(0.1);
+
+    cornerRefinementInput = new QComboBox(this);
+    cornerRefinementInput->addItem(tr("None"), cv::aruco::CORNER_REFINE_NONE);
+    cornerRefinementInput->addItem(tr("Subpixel"), cv::aruco::CORNER_REFINE_SUBPIX);
+    cornerRefinementInput->addItem(tr("Contour"), cv::aruco::CORNER_REFINE_CONTOUR);
+    cornerRefinementInput->addItem(tr("AprilTag"), cv::aruco::CORNER_REFINE_APRILTAG);
+
+    reducedDictionaryInput = new QCheckBox(tr("Only markers of known blocks"), this);
+    reducedDictionaryInput->setToolTip(
+        tr("Faster and more robust detection, but markers of new blocks are not detected"));
+
+    fusedThresholdInput = new QCheckBox(tr("All windows in one pass"), this);
+    fusedThresholdInput->setToolTip(
+        tr("Faster candidate search with the same thresholds. Contour and AprilTag "
+           "refinement always use the OpenCV detector"));
+
+    detectionWorkersInput = new QSpinBox(this);
+    detectionWorkersInput->setRange(1, DetectionPipeline::MAX_WORKERS);
+    detectionWorkersInput->setToolTip(
+        tr("Frames detected in parallel. Raises throughput, adds latency per extra frame"));
+
+    tileMarkerSizeInput = new QSpinBox(this);
+    tileMarkerSizeInput->setRange(0, 4096);
+    tileMarkerSizeInput->setSuffix(tr(" px"));
+    tileMarkerSizeInput->setSpecialValueText(tr("Whole frame"));
+    tileMarkerSizeInput->setToolTip(
+        tr("Largest marker side in the image. Large frames are split into tiles detected "
+           "in parallel, markers bigger than this may be missed"));
+
+    minSharpnessInput = new QDoubleSpinBox(this);
+    minSharpnessInput->setDecimals(0);
+    minSharpnessInput->setRange(0.0, 10000.0);
+    minSharpnessInput->setSingleStep(10.0);
+    minSharpnessInput->setSpecialValueText(tr("Every frame"));
+    minSharpnessInput->setToolTip(
+        tr("Blurred frames below this sharpness are not detected and cannot be captured, "
+           "the last pose is held. Set it a little below the sharpness of a still board"));
+
+    detectTimeValue = new QLabel("-", this);
+    markerCountValue = new QLabel("-", this);
+    sharpnessValue = new QLabel("-", this);
+    skippedFramesValue = new QLabel("-", this);
+
+    loadProfileButton = new QPushButton(tr("Load profile..."), this);
+    connect(
+        loadProfileButton, &QPushButton::clicked, this, &DetectorSettingsWidget::onLoadProfileButton);
+    saveProfileButton = new QPushButton(tr("Save profile..."), this);
+    connect(
+        saveProfileButton, &QPushButton::clicked, this, &DetectorSettingsWidget::onSaveProfileButton);
+
+    QHBoxLayout *profileLayout = new QHBoxLayout();
+    profileLayout->addWidget(loadProfileButton);
+    profileLayout->addWidget(saveProfileButton);
+
+    formLayout = new QFormLayout(this);
+    formLayout->addRow(tr("Threshold window min"), winSizeMinInput);
+    formLayout->addRow(tr("Threshold window max"), winSizeMaxInput);
+    formLayout->addRow(tr("Threshold window step"), winSizeStepInput);
+    formLayout->addRow(tr("Threshold constant"), threshConstantInput);
+    formLayout->addRow(tr("Min perimeter rate"), minPerimeterRateInput);
+    formLayout->addRow(tr("Max perimeter rate"), maxPerimeterRateInput);
+    formLayout->addRow(tr("Corner refinement"), cornerRefinementInput);
+    formLayout->addRow(tr("Dictionary"), reducedDictionaryInput);
+    formLayout->addRow(tr("Thresholding"), fusedThresholdInput);
+    formLayout->addRow(tr("Parallel frames"), detectionWorkersInput);
+    formLayout->addRow(tr("Tile marker size"), tileMarkerSizeInput);
+    formLayout->addRow(tr("Min sharpness"), minSharpnessInput);
+    formLayout->addRow(tr("Detect time"), detectTimeValue);
+    formLayout->addRow(tr("Markers detected"), markerCountValue);
+    formLayout->addRow(tr("Sharpness"), sharpnessValue);
+    formLayout->addRow(tr("Blurred frames skipped"), skippedFramesValue);
+    formLayout->addRow(profileLayout);
+    setLayout(formLayout);
+
+    setSettings(DetectorSettings{});
+
+    for (QSpinBox *input :
+         {winSizeMinInput,
+          winSizeMaxInput,
+          winSizeStepInput,
+          detectionWorkersInput,
+          tileMarkerSizeInput}) {
+        connect(
+            input,
+            QOverload<int>::of(&QSpinBox::valueChanged),
+            this,
+            &DetectorSettingsWidget::onSettingChanged);
+    }
+    for (QDoubleSpinBox *input :
+         {threshConstantInput, minPerimeterRateInput, maxPerimeterRateInput, minSharpnessInput}) {
+        connect(
+            input,
+            QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this,
+            &DetectorSettingsWidget::onSettingChanged);
+    }
+    connect(
+        cornerRefinementInput,
+        QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this,
+        &DetectorSettingsWidget::onSettingChanged);
+    for (QCheckBox *input : {reducedDictionaryInput, fusedThresholdInput}) {
+        connect(input, &QCheckBox::toggled, this, &DetectorSettingsWidget::onSettingChanged);
+    }
+}
+
+void DetectorSettingsWidget::setSettings(const DetectorSettings &settings)
+{
+    updating = true;
+    winSizeMinInput->setValue(settings.adaptiveThreshWinSizeMin);
+    winSizeMaxInput->setValue(settings.adaptiveThreshWinSizeMax);
+    winSizeStepInput->setValue(settings.adaptiveThreshWinSizeStep);
+    threshConstantInput->setValue(settings.adaptiveThreshConstant);
+    minPerimeterRateInput->setValue(settings.minMarkerPerimeterRate);
+    maxPerimeterRateInput->setValue(settings.maxMarkerPerimeterRate);
+    int index = cornerRefinementInput->findData(settings.cornerRefinementMethod);
+    cornerRefinementInput->setCurrentIndex(index < 0 ? 0 : index);
+    reducedDictionaryInput->setChecked(settings.useReducedDictionary);
+    fusedThresholdInput->setChecked(settings.useFusedThreshold);
+    detectionWorkersInput->setValue(settings.detectionWorkers);
+    tileMarkerSizeInput->setValue(settings.tileMarkerSize);
+    minSharpnessInput->setValue(settings.minSharpness);
+    updating = false;
+}
+
+DetectorSettings DetectorSettingsWidget::getSettings()
+{
+    DetectorSettings settings{};
+    settings.adaptiveThreshWinSizeMin = winSizeMinInput->value();
+    settings.adaptiveThreshWinSizeMax = winSizeMaxInput->value();
+    settings.adaptiveThreshWinSizeStep = winSizeStepInput->value();
+    settings.adaptiveThreshConstant = threshConstantInput->value();
+    settings.minMarkerPerimeterRate = minPerimeterRateInput->value();
+    settings.maxMarkerPerimeterRate = maxPerimeterRateInput->value();
+    settings.cornerRefinementMethod = cornerRefinementInput->currentData().toInt();
+    settings.useReducedDictionary = reducedDictionaryInput->isChecked();
+    settings.useFusedThreshold = fusedThresholdInput->isChecked();
+    settings.detectionWorkers = detectionWorkersInput->value();
+    settings.tileMarkerSize = tileMarkerSizeInput->value();
+    settings.minSharpness = minSharpnessInput->value();
+    return settings;
+}
+
+void DetectorSettingsWidget::onDetectionStats(double detectMs, int markerCount)
+{
+    // Smooth the per-frame time so the label stays readable
+    averageDetectMs = averageDetectMs > 0.0 ? 0.9 * averageDetectMs + 0.1 * detectMs : detectMs;
+    detectTimeValue->setText(tr("%1 ms").arg(averageDetectMs, 0, 'f', 2));
+    markerCountValue->setText(QString::number(markerCount));
+}
+
+void DetectorSettingsWidget::onSharpnessStats(double sharpness, int skippedFrames)
+{
+    averageSharpness = averageSharpness > 0.0 ? 0.9 * averageSharpness + 0.1 * sharpness
+                                              : sharpness;
+    sharpnessValue->setText(QString::number(averageSharpness, 'f', 0));
+    skippedFramesValue->setText(QString::number(skippedFrames));
+}
+
+void DetectorSettingsWidget::onSettingChanged()
+{
+    if (updating)
+        return;
+    averageDetectMs = 0.0;
+    emit settingsChanged(getSettings());
+}
+
+void DetectorSettingsWidget::onLoadProfileButton()
+{
+    QString fileName = QFileDialog::getOpenFileName(
+        this, tr("Load detector profile"), "detector.yml", tr("YAML files (*.yml)"));
+    if (!fileName.isEmpty()) {
+        emit loadProfile(fileName);
+    }
+}
+
+void DetectorSettingsWidget::onSaveProfileButton()
+{
+    QString fileName = QFileDialog::getSaveFileName(
+        this, tr("Save detector profile"), "detector.yml", tr("YAML files (*.yml)"));
+    if (!fileName.isEmpty()) {
+        emit saveProfile(fileName);
+    }
+}
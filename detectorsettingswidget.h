@@ -0,0 +1,63 @@
+#ifndef DETECTORSETTINGSWIDGET_H
+#define DETECTORSETTINGSWIDGET_H
+
+#include "yamlhandler.h"
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QWidget>
+
+class DetectorSettingsWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit DetectorSettingsWidget(QWidget *parent = nullptr);
+
+    void setSettings(const DetectorSettings &settings);
+    DetectorSettings getSettings();
+
+signals:
+    void settingsChanged(const DetectorSettings &settings);
+    void loadProfile(const QString &fileName);
+    void saveProfile(const QString &fileName);
+
+public slots:
+    void onDetectionStats(double detectMs, int markerCount);
+    void onSharpnessStats(double sharpness, int skippedFrames);
+
+private:
+    QFormLayout *formLayout;
+    QSpinBox *winSizeMinInput;
+    QSpinBox *winSizeMaxInput;
+    QSpinBox *winSizeStepInput;
+    QDoubleSpinBox *threshConstantInput;
+    QDoubleSpinBox *minPerimeterRateInput;
+    QDoubleSpinBox *maxPerimeterRateInput;
+    QComboBox *cornerRefinementInput;
+    QCheckBox *reducedDictionaryInput;
+    QCheckBox *fusedThresholdInput;
+    QSpinBox *detectionWorkersInput;
+    QSpinBox *tileMarkerSizeInput;
+    QDoubleSpinBox *minSharpnessInput;
+    QLabel *detectTimeValue;
+    QLabel *markerCountValue;
+    QLabel *sharpnessValue;
+    QLabel *skippedFramesValue;
+    QPushButton *loadProfileButton;
+    QPushButton *saveProfileButton;
+
+    double averageDetectMs;
+    double averageSharpness;
+    bool updating;
+
+private slots:
+    void onSettingChanged();
+    void onLoadProfileButton();
+    void onSaveProfileButton();
+};
+
+#endif // DETECTORSETTINGSWIDGET_H
@@ -0,0 +1,52 @@
+#include "displayframepool.h"
+
+DisplayFramePool::DisplayFramePool(size_t capacity)
+{
+    for (size_t i = 0; i < capacity; i++) {
+        buffers.push_back(std::make_shared<Buffer>());
+    }
+}
+
+QImage DisplayFramePool::convert(const CameraFrame &frame, const cv::Size &size)
+{
+    if (frame.empty())
+        return QImage();
+
+    std::shared_ptr<Buffer> buffer = acquire();
+    if (frame.deviceSize() == size) {
+        frame.toRgb(buffer->rgb);
+    } else {
+        frame.toRgb(buffer->fullSize);
+        cv::resize(buffer->fullSize, buffer->rgb, size);
+    }
+
+    // The cleanup info keeps the buffer alive even if the pool is gone first
+    return QImage(
+        buffer->rgb.data,
+        buffer->rgb.cols,
+        buffer->rgb.rows,
+        (int) buffer->rgb.step,
+        QImage::Format_RGB888,
+        &DisplayFramePool::release,
+        new std::shared_ptr<Buffer>(buffer));
+}
+
+std::shared_ptr<DisplayFramePool::Buffer> DisplayFramePool::acquire()
+{
+    for (const std::shared_ptr<Buffer> &buffer : buffers) {
+        bool expected = false;
+        if (buffer->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            return buffer;
+    }
+    // The GUI is holding every buffer, fall back to a one-off allocation
+    std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>();
+    buffer->inUse.store(true, std::memory_order_relaxed);
+    return buffer;
+}
+
+void DisplayFramePool::release(void *info)
+{
+    auto buffer = static_cast<std::shared_ptr<Buffer> *>(info);
+    (*buffer)->inUse.store(false, std::memory_order_release);
+    delete buffer;
+}
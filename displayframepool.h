@@ -0,0 +1,37 @@
+#ifndef DISPLAYFRAMEPOOL_H
+#define DISPLAYFRAMEPOOL_H
+
+#include "cameraframe.h"
+#include <atomic>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <QImage>
+#include <vector>
+
+// Converts camera frames into a small set of reusable RGB buffers on the
+// calling thread. The returned QImage shares the buffer memory and gives the buffer
+// back to the pool once the last copy of the image is destroyed.
+class DisplayFramePool
+{
+public:
+    explicit DisplayFramePool(size_t capacity = 4);
+
+    // Colour conversion at full size, then scaled to size
+    QImage convert(const CameraFrame &frame, const cv::Size &size);
+
+private:
+    struct Buffer
+    {
+        cv::Mat rgb;
+        // Full size colour before scaling
+        cv::Mat fullSize;
+        std::atomic<bool> inUse{false};
+    };
+
+    std::vector<std::shared_ptr<Buffer>> buffers;
+
+    std::shared_ptr<Buffer> acquire();
+    static void release(void *info);
+};
+
+#endif // DISPLAYFRAMEPOOL_H
@@ -0,0 +1,30 @@
+#include "frameitem.h"
+#include "latencymetrics.h"
+#include <QPainter>
+
+FrameItem::FrameItem(QGraphicsItem *parent)
+    : QGraphicsItem(parent)
+{}
+
+void FrameItem::setImage(const QImage &newImage)
+{
+    if (newImage.size() != image.size())
+        prepareGeometryChange();
+    image = newImage;
+    update();
+}
+
+QRectF FrameItem::boundingRect() const
+{
+    return QRectF(QPointF(0, 0), image.size());
+}
+
+void FrameItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+    if (image.isNull())
+        return;
+    ScopedStageTimer timer(Stage::Paint);
+    painter->drawImage(QPointF(0, 0), image);
+}
@@ -0,0 +1,23 @@
+#ifndef FRAMEITEM_H
+#define FRAMEITEM_H
+
+#include <QGraphicsItem>
+#include <QImage>
+
+// Scene item that paints the latest frame straight from its QImage,
+// without converting it to a QPixmap first
+class FrameItem : public QGraphicsItem
+{
+public:
+    explicit FrameItem(QGraphicsItem *parent = nullptr);
+
+    void setImage(const QImage &newImage);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+    QImage image;
+};
+
+#endif // FRAMEITEM_H
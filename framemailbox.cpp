@@ -0,0 +1,21 @@
+#include "framemailbox.h"
+
+FrameMailbox::FrameMailbox()
+    : sequence(0)
+    , active(true)
+{}
+
+void FrameMailbox::post(const QImage &image, const FrameOverlay &overlay, qint64 timestamp)
+{
+    auto newFrame = std::make_shared<DisplayFrame>();
+    newFrame->image = image;
+    newFrame->overlay = overlay;
+    newFrame->timestamp = timestamp;
+    newFrame->sequence = sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    std::atomic_store(&frame, std::shared_ptr<const DisplayFrame>(std::move(newFrame)));
+}
+
+std::shared_ptr<const DisplayFrame> FrameMailbox::latest() const
+{
+    return std::atomic_load(&frame);
+}
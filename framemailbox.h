@@ -0,0 +1,38 @@
+#ifndef FRAMEMAILBOX_H
+#define FRAMEMAILBOX_H
+
+#include "frameoverlay.h"
+#include <atomic>
+#include <memory>
+#include <QImage>
+
+struct DisplayFrame
+{
+    QImage image;
+    FrameOverlay overlay;
+    qint64 timestamp;
+    quint64 sequence;
+};
+
+// Single slot hand-over of the newest frame from the processing threads to
+// the view. Posting replaces any frame the view has not picked up yet, the
+// view pulls at display rate and tells producers whether anyone is watching.
+class FrameMailbox
+{
+public:
+    FrameMailbox();
+
+    void post(const QImage &image, const FrameOverlay &overlay, qint64 timestamp);
+    std::shared_ptr<const DisplayFrame> latest() const;
+
+    // Producers can skip preparing display frames while the view is hidden
+    bool isActive() const { return active.load(std::memory_order_relaxed); }
+    void setActive(bool isActive) { active.store(isActive, std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<const DisplayFrame> frame;
+    std::atomic<quint64> sequence;
+    std::atomic<bool> active;
+};
+
+#endif // FRAMEMAILBOX_H
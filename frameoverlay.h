@@ -0,0 +1,27 @@
+#ifndef FRAMEOVERLAY_H
+#define FRAMEOVERLAY_H
+
+#include <QPolygonF>
+#include <QString>
+#include <vector>
+
+enum class OverlayLayer { Markers, SelectedPoint, Distance };
+
+struct OverlayMarker
+{
+    int id;
+    // Corners in frame pixel coordinates, first one is the top left corner of the marker
+    QPolygonF corners;
+};
+
+// Annotations for one frame, drawn by the view on top of the video instead of
+// being rendered into the frame pixels
+struct FrameOverlay
+{
+    std::vector<OverlayMarker> markers;
+    bool hasSelectedPoint = false;
+    QPointF selectedPoint;
+    QString distanceText;
+};
+
+#endif // FRAMEOVERLAY_H
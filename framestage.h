@@ -0,0 +1,18 @@
+#ifndef FRAMESTAGE_H
+#define FRAMESTAGE_H
+
+#include "cameraframe.h"
+
+// Processing attached to the capture service. process() runs on the capture
+// thread for every frame while the stage is the active one. A stage reports
+// each frame it completes with LatencyMetrics::recordFrame(), tracking may
+// complete a frame after process() has returned.
+class FrameStage
+{
+public:
+    virtual ~FrameStage() = default;
+
+    virtual void process(const CameraFrame &frame) = 0;
+};
+
+#endif // FRAMESTAGE_H
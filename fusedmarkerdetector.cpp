@@ -0,0 +1,413 @@
+#include "fusedmarkerdetector.h"
+#include "taskexecutor.h"
+#include <numeric>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace {
+
+// Image rows thresholded by one parallelFor index
+const int BAND_ROWS = 64;
+
+// Integral image with one more row and column than the image. The totals of
+// a large frame overflow, but a window sum is always below 2^32, so the four
+// entries of a window still subtract to the exact sum.
+void integralImage(const cv::Mat &image, std::vector<uint32_t> &sum, size_t stride)
+{
+    sum.assign(stride * (image.rows + 1), 0);
+    std::vector<uint32_t> rowSum(stride, 0);
+
+    for (int y = 0; y < image.rows; y++) {
+        const uchar *src = image.ptr<uchar>(y);
+        uint32_t running = 0;
+        for (int x = 0; x < image.cols; x++) {
+            running += src[x];
+            rowSum[x + 1] = running;
+        }
+
+        const uint32_t *above = &sum[y * stride];
+        uint32_t *row = &sum[(y + 1) * stride];
+        int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int lanes = cv::VTraits<cv::v_uint32>::vlanes();
+        for (; x <= (int) stride - lanes; x += lanes) {
+            cv::v_store(row + x, cv::v_add(cv::vx_load(above + x), cv::vx_load(&rowSum[x])));
+        }
+#endif
+        for (; x < (int) stride; x++) {
+            row[x] = above[x] + rowSum[x];
+        }
+    }
+}
+
+// One row of one window. top and bottom point at the integral rows above and
+// below the window, at the column of its left edge for the first pixel.
+// Sets pixels with src - mean <= -delta like cv::adaptiveThreshold(), the
+// mean rounded to nearest as by its box filter.
+void thresholdRow(
+    const uchar *src,
+    const uint32_t *top,
+    const uint32_t *bottom,
+    int side,
+    int delta,
+    int width,
+    uchar *dst)
+{
+    int area = side * side;
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+    const int quarter = cv::VTraits<cv::v_uint32>::vlanes();
+    const cv::v_float32 scale = cv::vx_setall_f32(1.f / area);
+    const cv::v_int32 vArea = cv::vx_setall_s32(area);
+    const cv::v_int32 vNegArea = cv::vx_setall_s32(-area);
+    const cv::v_int32 vDelta = cv::vx_setall_s32(delta);
+
+    auto mask = [&](int i, const cv::v_uint32 &pixels) {
+        cv::v_int32 box = cv::v_reinterpret_as_s32(cv::v_add(
+            cv::v_sub(cv::vx_load(bottom + i + side), cv::vx_load(top + i + side)),
+            cv::v_sub(cv::vx_load(top + i), cv::vx_load(bottom + i))));
+        // The float quotient can be one off for large windows, the remainder
+        // has to stay within half a window either way
+        cv::v_int32 mean = cv::v_round(cv::v_mul(cv::v_cvt_f32(box), scale));
+        cv::v_int32 twiceRemainder = cv::v_shl<1>(cv::v_sub(box, cv::v_mul(mean, vArea)));
+        mean = cv::v_sub(mean, cv::v_gt(twiceRemainder, vArea));
+        mean = cv::v_add(mean, cv::v_lt(twiceRemainder, vNegArea));
+        return cv::v_le(cv::v_add(cv::v_reinterpret_as_s32(pixels), vDelta), mean);
+    };
+
+    for (; x <= width - lanes; x += lanes) {
+        cv::v_uint16 low, high;
+        cv::v_expand(cv::vx_load(src + x), low, high);
+        cv::v_uint32 p0, p1, p2, p3;
+        cv::v_expand(low, p0, p1);
+        cv::v_expand(high, p2, p3);
+        cv::v_int16 first = cv::v_pack(mask(x, p0), mask(x + quarter, p1));
+        cv::v_int16 second = cv::v_pack(mask(x + 2 * quarter, p2), mask(x + 3 * quarter, p3));
+        cv::v_store(dst + x, cv::v_reinterpret_as_u8(cv::v_pack(first, second)));
+    }
+#endif
+    for (; x < width; x++) {
+        uint32_t box = bottom[x + side] - top[x + side] - bottom[x] + top[x];
+        int mean = (int) ((2 * box + area) / (2 * area));
+        dst[x] = src[x] + delta <= mean ? 255 : 0;
+    }
+}
+
+} // namespace
+
+FusedMarkerDetector::FusedMarkerDetector(
+    const cv::aruco::Dictionary &dictionary, const cv::aruco::DetectorParameters &params)
+    : dictionary(dictionary)
+    , params(params)
+{}
+
+bool FusedMarkerDetector::supports(const cv::aruco::DetectorParameters &params)
+{
+    bool refinement = params.cornerRefinementMethod == cv::aruco::CORNER_REFINE_NONE
+                      || params.cornerRefinementMethod == cv::aruco::CORNER_REFINE_SUBPIX;
+    return refinement && !params.useAruco3Detection && !params.detectInvertedMarker
+           && params.adaptiveThreshWinSizeMin >= 3
+           && params.adaptiveThreshWinSizeMax >= params.adaptiveThreshWinSizeMin
+           && params.adaptiveThreshWinSizeStep > 0;
+}
+
+std::vector<int> FusedMarkerDetector::windowSizes() const
+{
+    std::vector<int> sizes;
+    int count = (params.adaptiveThreshWinSizeMax - params.adaptiveThreshWinSizeMin)
+                    / params.adaptiveThreshWinSizeStep
+                + 1;
+    for (int i = 0; i < count; i++) {
+        int size = params.adaptiveThreshWinSizeMin + i * params.adaptiveThreshWinSizeStep;
+        // Windows must be odd, the stock detector rounds up the same way
+        sizes.push_back(size % 2 == 0 ? size + 1 : size);
+    }
+    return sizes;
+}
+
+void FusedMarkerDetector::threshold(const cv::Mat &grey, std::vector<cv::Mat> &thresholds) const
+{
+    CV_Assert(grey.type() == CV_8UC1);
+    std::vector<int> sizes = windowSizes();
+    int radius = sizes.back() / 2;
+
+    // Replicated borders as in the box filter of cv::adaptiveThreshold()
+    cv::Mat padded;
+    cv::copyMakeBorder(
+        grey,
+        padded,
+        radius,
+        radius,
+        radius,
+        radius,
+        cv::BORDER_REPLICATE | cv::BORDER_ISOLATED);
+    size_t stride = padded.cols + 1;
+    std::vector<uint32_t> sum;
+    integralImage(padded, sum, stride);
+
+    thresholds.resize(sizes.size());
+    for (cv::Mat &thresholded : thresholds) {
+        thresholded.create(grey.size(), CV_8UC1);
+    }
+
+    int delta = cvFloor(params.adaptiveThreshConstant);
+    int bands = (grey.rows + BAND_ROWS - 1) / BAND_ROWS;
+    TaskExecutor::instance().parallelFor(bands, [&](int band) {
+        int end = std::min(grey.rows, (band + 1) * BAND_ROWS);
+        for (int y = band * BAND_ROWS; y < end; y++) {
+            // All windows of a row read the same few integral rows
+            for (size_t i = 0; i < sizes.size(); i++) {
+                int half = sizes[i] / 2;
+                int left = radius - half;
+                thresholdRow(
+                    grey.ptr<uchar>(y),
+                    &sum[(y + radius - half) * stride + left],
+                    &sum[(y + radius + half + 1) * stride + left],
+                    sizes[i],
+                    delta,
+                    grey.cols,
+                    thresholds[i].ptr<uchar>(y));
+            }
+        }
+    });
+}
+
+void FusedMarkerDetector::detectMarkers(
+    const cv::Mat &image,
+    std::vector<std::vector<cv::Point2f>> &corners,
+    std::vector<int> &ids) const
+{
+    corners.clear();
+    ids.clear();
+
+    cv::Mat grey;
+    if (image.channels() == 3) {
+        cv::cvtColor(image, grey, cv::COLOR_BGR2GRAY);
+    } else {
+        grey = image;
+    }
+
+    std::vector<cv::Mat> thresholds;
+    threshold(grey, thresholds);
+
+    std::vector<std::vector<Candidate>> windowCandidates(thresholds.size());
+    TaskExecutor::instance().parallelFor((int) thresholds.size(), [&](int i) {
+        findCandidates(thresholds[i], windowCandidates[i]);
+    });
+    std::vector<Candidate> candidates;
+    for (const std::vector<Candidate> &found : windowCandidates) {
+        candidates.insert(candidates.end(), found.begin(), found.end());
+    }
+
+    // The same square is found at several windows and on both sides of its
+    // black border. Candidates closer than minMarkerDistanceRate of the
+    // smaller perimeter are grouped and the biggest identified one is kept.
+    std::vector<size_t> parent(candidates.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto root = [&parent](size_t i) {
+        while (parent[i] != i) {
+            i = parent[i] = parent[parent[i]];
+        }
+        return i;
+    };
+    for (size_t i = 0; i < candidates.size(); i++) {
+        for (size_t j = i + 1; j < candidates.size(); j++) {
+            double minDistance = std::min(candidates[i].perimeter, candidates[j].perimeter)
+                                 * params.minMarkerDistanceRate;
+            for (int first = 0; first < 4; first++) {
+                double distanceSq = 0.0;
+                for (int c = 0; c < 4; c++) {
+                    cv::Point2f d = candidates[i].corners[(c + first) % 4]
+                                    - candidates[j].corners[c];
+                    distanceSq += d.dot(d);
+                }
+                if (distanceSq / 4.0 < minDistance * minDistance) {
+                    parent[root(j)] = root(i);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<std::vector<size_t>> groups;
+    std::vector<int> groupOf(candidates.size(), -1);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        size_t r = root(i);
+        if (groupOf[r] < 0) {
+            groupOf[r] = (int) groups.size();
+            groups.emplace_back();
+        }
+        groups[groupOf[r]].push_back(i);
+    }
+
+    std::vector<std::vector<cv::Point2f>> groupCorners(groups.size());
+    std::vector<int> groupIds(groups.size(), -1);
+    TaskExecutor::instance().parallelFor((int) groups.size(), [&](int g) {
+        std::vector<size_t> &group = groups[g];
+        std::stable_sort(group.begin(), group.end(), [&candidates](size_t a, size_t b) {
+            return candidates[a].perimeter > candidates[b].perimeter;
+        });
+        for (size_t i : group) {
+            std::vector<cv::Point2f> markerCorners = candidates[i].corners;
+            int id;
+            if (identify(grey, markerCorners, id)) {
+                groupCorners[g] = markerCorners;
+                groupIds[g] = id;
+                return;
+            }
+        }
+    });
+    for (size_t g = 0; g < groups.size(); g++) {
+        if (groupIds[g] < 0)
+            continue;
+        corners.push_back(groupCorners[g]);
+        ids.push_back(groupIds[g]);
+    }
+
+    if (params.cornerRefinementMethod == cv::aruco::CORNER_REFINE_SUBPIX) {
+        int cells = dictionary.markerSize + 2 * params.markerBorderBits;
+        TaskExecutor::instance().parallelFor((int) corners.size(), [&](int i) {
+            // Window relative to the module size, capped like the stock detector
+            float perimeter = 0.f;
+            for (int c = 0; c < 4; c++) {
+                perimeter += (float) cv::norm(corners[i][c] - corners[i][(c + 1) % 4]);
+            }
+            int winSize = std::max(
+                1, cvRound(params.relativeCornerRefinmentWinSize * perimeter / (4 * cells)));
+            winSize = std::min(winSize, params.cornerRefinementWinSize);
+            cv::cornerSubPix(
+                grey,
+                corners[i],
+                cv::Size(winSize, winSize),
+                cv::Size(-1, -1),
+                cv::TermCriteria(
+                    cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS,
+                    params.cornerRefinementMaxIterations,
+                    params.cornerRefinementMinAccuracy));
+        });
+    }
+}
+
+void FusedMarkerDetector::findCandidates(
+    const cv::Mat &thresholded, std::vector<Candidate> &candidates) const
+{
+    int maxSide = std::max(thresholded.cols, thresholded.rows);
+    size_t minPerimeter = (unsigned int) (params.minMarkerPerimeterRate * maxSide);
+    size_t maxPerimeter = (unsigned int) (params.maxMarkerPerimeterRate * maxSide);
+    int border = params.minDistanceToBorder;
+
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(thresholded, contours, cv::RETR_LIST, cv::CHAIN_APPROX_NONE);
+
+    std::vector<cv::Point> polygon;
+    for (const std::vector<cv::Point> &contour : contours) {
+        if (contour.size() < minPerimeter || contour.size() > maxPerimeter)
+            continue;
+        cv::approxPolyDP(
+            contour, polygon, contour.size() * params.polygonalApproxAccuracyRate, true);
+        if (polygon.size() != 4 || !cv::isContourConvex(polygon))
+            continue;
+
+        double minSideSq = (double) maxSide * maxSide;
+        bool nearBorder = false;
+        for (int c = 0; c < 4; c++) {
+            cv::Point d = polygon[c] - polygon[(c + 1) % 4];
+            minSideSq = std::min(minSideSq, (double) d.dot(d));
+            nearBorder = nearBorder || polygon[c].x < border || polygon[c].y < border
+                         || polygon[c].x > thresholded.cols - 1 - border
+                         || polygon[c].y > thresholded.rows - 1 - border;
+        }
+        double minCornerDistance = contour.size() * params.minCornerDistanceRate;
+        if (minSideSq < minCornerDistance * minCornerDistance || nearBorder)
+            continue;
+
+        Candidate candidate;
+        candidate.corners.assign(polygon.begin(), polygon.end());
+        candidate.perimeter = (int) contour.size();
+        // Clockwise, as the dictionary rotations expect
+        cv::Point2f d1 = candidate.corners[1] - candidate.corners[0];
+        cv::Point2f d2 = candidate.corners[2] - candidate.corners[0];
+        if (d1.cross(d2) < 0.0)
+            std::swap(candidate.corners[1], candidate.corners[3]);
+        candidates.push_back(candidate);
+    }
+}
+
+bool FusedMarkerDetector::identify(
+    const cv::Mat &grey, std::vector<cv::Point2f> &corners, int &id) const
+{
+    cv::Mat bits = extractBits(grey, corners);
+    int borderBits = params.markerBorderBits;
+    int cells = dictionary.markerSize + 2 * borderBits;
+
+    int borderErrors = 0;
+    for (int i = 0; i < cells; i++) {
+        for (int k = 0; k < borderBits; k++) {
+            borderErrors += bits.at<uchar>(i, k) != 0;
+            borderErrors += bits.at<uchar>(i, cells - 1 - k) != 0;
+            if (i >= borderBits && i < cells - borderBits) {
+                borderErrors += bits.at<uchar>(k, i) != 0;
+                borderErrors += bits.at<uchar>(cells - 1 - k, i) != 0;
+            }
+        }
+    }
+    int maxBorderErrors = (int) (dictionary.markerSize * dictionary.markerSize
+                                 * params.maxErroneousBitsInBorderRate);
+    if (borderErrors > maxBorderErrors)
+        return false;
+
+    cv::Mat innerBits
+        = bits(cv::Rect(borderBits, borderBits, dictionary.markerSize, dictionary.markerSize))
+              .clone();
+    int rotation;
+    if (!dictionary.identify(innerBits, id, rotation, params.errorCorrectionRate))
+        return false;
+
+    std::rotate(corners.begin(), corners.begin() + 4 - rotation, corners.end());
+    return true;
+}
+
+cv::Mat FusedMarkerDetector::extractBits(
+    const cv::Mat &grey, const std::vector<cv::Point2f> &corners) const
+{
+    int cellSize = params.perspectiveRemovePixelPerCell;
+    int cells = dictionary.markerSize + 2 * params.markerBorderBits;
+    int cellMargin = (int) (params.perspectiveRemoveIgnoredMarginPerCell * cellSize);
+    int side = cells * cellSize;
+
+    std::vector<cv::Point2f> square = {
+        cv::Point2f(0, 0),
+        cv::Point2f(side - 1, 0),
+        cv::Point2f(side - 1, side - 1),
+        cv::Point2f(0, side - 1)};
+    cv::Mat warped;
+    cv::warpPerspective(
+        grey,
+        warped,
+        cv::getPerspectiveTransform(corners, square),
+        cv::Size(side, side),
+        cv::INTER_NEAREST);
+
+    cv::Mat bits(cells, cells, CV_8UC1, cv::Scalar::all(0));
+
+    // A nearly uniform marker is all black or all white, Otsu would split noise
+    cv::Scalar mean, stddev;
+    int inner = side - 2 * (cellSize / 2);
+    cv::meanStdDev(warped(cv::Rect(cellSize / 2, cellSize / 2, inner, inner)), mean, stddev);
+    if (stddev[0] < params.minOtsuStdDev) {
+        bits.setTo(mean[0] > 127 ? 1 : 0);
+        return bits;
+    }
+
+    cv::threshold(warped, warped, 125, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    int cellInner = cellSize - 2 * cellMargin;
+    for (int y = 0; y < cells; y++) {
+        for (int x = 0; x < cells; x++) {
+            cv::Mat cell = warped(cv::Rect(
+                x * cellSize + cellMargin, y * cellSize + cellMargin, cellInner, cellInner));
+            if ((size_t) cv::countNonZero(cell) > cell.total() / 2)
+                bits.at<uchar>(y, x) = 1;
+        }
+    }
+    return bits;
+}
@@ -0,0 +1,51 @@
+#ifndef FUSEDMARKERDETECTOR_H
+#define FUSEDMARKERDETECTOR_H
+
+#include <opencv2/aruco.hpp>
+#include <opencv2/opencv.hpp>
+
+// ArUco detection with a faster candidate search. cv::aruco::ArucoDetector
+// box filters the image once per adaptive threshold window, here all windows
+// are thresholded from one integral image in a single vectorized pass. The
+// thresholds are bit-exact with cv::adaptiveThreshold(), contours, bit
+// extraction and Dictionary::identify() follow the stock detector.
+// detectMarkers() may be called from several threads at once.
+class FusedMarkerDetector
+{
+public:
+    FusedMarkerDetector() = default;
+    FusedMarkerDetector(
+        const cv::aruco::Dictionary &dictionary, const cv::aruco::DetectorParameters &params);
+
+    // Contour and AprilTag corner refinement, ArUco3 and inverted markers are
+    // left to the stock detector
+    static bool supports(const cv::aruco::DetectorParameters &params);
+
+    void detectMarkers(
+        const cv::Mat &image,
+        std::vector<std::vector<cv::Point2f>> &corners,
+        std::vector<int> &ids) const;
+
+    // Window sizes thresholded by detectMarkers(), in order
+    std::vector<int> windowSizes() const;
+    // One binary image per window size, same as cv::adaptiveThreshold() with
+    // ADAPTIVE_THRESH_MEAN_C and THRESH_BINARY_INV
+    void threshold(const cv::Mat &grey, std::vector<cv::Mat> &thresholds) const;
+
+private:
+    struct Candidate
+    {
+        std::vector<cv::Point2f> corners;
+        // Contour length in pixels
+        int perimeter;
+    };
+
+    cv::aruco::Dictionary dictionary;
+    cv::aruco::DetectorParameters params;
+
+    void findCandidates(const cv::Mat &thresholded, std::vector<Candidate> &candidates) const;
+    bool identify(const cv::Mat &grey, std::vector<cv::Point2f> &corners, int &id) const;
+    cv::Mat extractBits(const cv::Mat &grey, const std::vector<cv::Point2f> &corners) const;
+};
+
+#endif // FUSEDMARKERDETECTOR_H
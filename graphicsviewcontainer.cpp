@@ -1,22 +1,147 @@
 #include "graphicsviewcontainer.h"
+#include "latencymetrics.h"
+#include <QPen>
+#include <QScreen>
+#include <QWindow>
 
 GraphicsViewContainer::GraphicsViewContainer(QWidget *parent)
     : QWidget(parent)
-    , pixmapItem(new QGraphicsPixmapItem())
+    , frameItem(new FrameItem())
+    , frameMailbox(nullptr)
+    , displayedSequence(0)
 {
     scene = new QGraphicsScene(this);
     view = new QGraphicsView(scene);
     layout = new QVBoxLayout(this);
-    scene->addItem(pixmapItem);
+    scene->addItem(frameItem);
+
+    markersLayer = new QGraphicsItemGroup(frameItem);
+    selectedPointLayer = new QGraphicsItemGroup(frameItem);
+    distanceLayer = new QGraphicsItemGroup(frameItem);
+
+    // Outlines and text keep their on-screen size when the video is scaled
+    QPen pointPen(Qt::red);
+    pointPen.setCosmetic(true);
+    selectedPointItem = new QGraphicsEllipseItem(-5, -5, 10, 10, selectedPointLayer);
+    selectedPointItem->setPen(pointPen);
+    selectedPointItem->setBrush(Qt::red);
+    selectedPointItem->setFlag(QGraphicsItem::ItemIgnoresTransformations);
+    selectedPointItem->hide();
+
+    distanceItem = new QGraphicsSimpleTextItem(distanceLayer);
+    distanceItem->setBrush(Qt::green);
+    QFont distanceFont = distanceItem->font();
+    distanceFont.setPointSize(16);
+    distanceFont.setBold(true);
+    distanceItem->setFont(distanceFont);
+    distanceItem->setPos(50, 25);
+    distanceItem->setFlag(QGraphicsItem::ItemIgnoresTransformations);
+    distanceItem->hide();
 
     layout->addWidget(view);
     scene->setSceneRect(0, 0, view->width(), view->height());
+
+    displayTimer = new QTimer(this);
+    displayTimer->setTimerType(Qt::PreciseTimer);
+    connect(displayTimer, &QTimer::timeout, this, &GraphicsViewContainer::onDisplayTimer);
+}
+
+void GraphicsViewContainer::setFrameMailbox(FrameMailbox *mailbox)
+{
+    // The previous producer has nobody watching any more
+    if (frameMailbox && frameMailbox != mailbox)
+        frameMailbox->setActive(false);
+    frameMailbox = mailbox;
+    displayedSequence = 0;
+    if (frameMailbox && !displayTimer->isActive())
+        displayTimer->start(16);
+}
+
+void GraphicsViewContainer::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    // Pace to the refresh rate of the screen the window is on
+    QScreen *currentScreen = screen();
+    if (currentScreen && currentScreen->refreshRate() > 0)
+        displayTimer->setInterval(qMax(1, qRound(1000.0 / currentScreen->refreshRate())));
+}
+
+bool GraphicsViewContainer::isDisplayed() const
+{
+    if (!isVisible() || window()->isMinimized())
+        return false;
+    // Not exposed when the window is fully covered or on another virtual desktop
+    QWindow *handle = window()->windowHandle();
+    return !handle || handle->isExposed();
 }
 
-void GraphicsViewContainer::updateFrame(const cv::Mat &frame)
+void GraphicsViewContainer::onDisplayTimer()
 {
-    cv::Mat frameCopy = frame.clone();
-    QImage img(frameCopy.data, frameCopy.cols, frameCopy.rows, frameCopy.step, QImage::Format_RGB888);
-    pixmapItem->setPixmap(QPixmap::fromImage(img.rgbSwapped()));
-    view->update();
+    // Producers keep running for tracking and only skip the display frames
+    bool displayed = isDisplayed();
+    frameMailbox->setActive(displayed);
+    if (!displayed)
+        return;
+
+    std::shared_ptr<const DisplayFrame> frame = frameMailbox->latest();
+    if (!frame || frame->sequence == displayedSequence)
+        return;
+    displayedSequence = frame->sequence;
+
+    LatencyMetrics::instance().record(Stage::QueueDelay, frame->timestamp, LatencyMetrics::now());
+    // The image already holds RGB data owned by the producing thread's pool
+    frameItem->setImage(frame->image);
+    updateOverlay(frame->overlay);
+}
+
+void GraphicsViewContainer::setLayerVisible(OverlayLayer layer, bool visible)
+{
+    switch (layer) {
+    case OverlayLayer::Markers:
+        markersLayer->setVisible(visible);
+        break;
+    case OverlayLayer::SelectedPoint:
+        selectedPointLayer->setVisible(visible);
+        break;
+    case OverlayLayer::Distance:
+        distanceLayer->setVisible(visible);
+        break;
+    }
+}
+
+void GraphicsViewContainer::updateOverlay(const FrameOverlay &overlay)
+{
+    // Grow the item pool to the largest marker count seen so far
+    while (markerOutlines.size() < overlay.markers.size()) {
+        QPen outlinePen(Qt::green, 2);
+        outlinePen.setCosmetic(true);
+        QGraphicsPolygonItem *outline = new QGraphicsPolygonItem(markersLayer);
+        outline->setPen(outlinePen);
+        markerOutlines.push_back(outline);
+
+        QGraphicsSimpleTextItem *label = new QGraphicsSimpleTextItem(markersLayer);
+        label->setBrush(Qt::blue);
+        label->setFlag(QGraphicsItem::ItemIgnoresTransformations);
+        markerLabels.push_back(label);
+    }
+
+    for (size_t i = 0; i < markerOutlines.size(); i++) {
+        bool used = i < overlay.markers.size();
+        markerOutlines[i]->setVisible(used);
+        markerLabels[i]->setVisible(used);
+        if (!used)
+            continue;
+
+        const OverlayMarker &marker = overlay.markers[i];
+        markerOutlines[i]->setPolygon(marker.corners);
+        markerLabels[i]->setText(QString("id=%1").arg(marker.id));
+        markerLabels[i]->setPos(marker.corners.boundingRect().center());
+    }
+
+    selectedPointItem->setVisible(overlay.hasSelectedPoint);
+    distanceItem->setVisible(overlay.hasSelectedPoint);
+    if (overlay.hasSelectedPoint) {
+        selectedPointItem->setPos(overlay.selectedPoint);
+        distanceItem->setText(overlay.distanceText);
+    }
 }
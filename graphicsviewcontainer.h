@@ -1,12 +1,17 @@
 #ifndef GRAPHICSVIEWCONTAINER_H
 #define GRAPHICSVIEWCONTAINER_H
 
-#include <opencv2/opencv.hpp>
+#include "frameitem.h"
+#include "framemailbox.h"
+#include <QGraphicsEllipseItem>
+#include <QGraphicsItemGroup>
+#include <QGraphicsPolygonItem>
 #include <QGraphicsScene>
+#include <QGraphicsSimpleTextItem>
 #include <QGraphicsView>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
-#include <QGraphicsPixmapItem>
 
 class GraphicsViewContainer : public QWidget
 {
@@ -16,15 +21,39 @@ public:
     explicit GraphicsViewContainer(QWidget *parent = nullptr);
 
     QGraphicsView *getView() { return view; }
+    void setFrameMailbox(FrameMailbox *mailbox);
 
 public slots:
-    void updateFrame(const cv::Mat &frame);
+    void setLayerVisible(OverlayLayer layer, bool visible);
+
+protected:
+    void showEvent(QShowEvent *event) override;
 
 private:
     QGraphicsScene *scene;
     QGraphicsView *view;
     QVBoxLayout *layout;
-    QGraphicsPixmapItem *pixmapItem;
+    FrameItem *frameItem;
+
+    // Frames are pulled from the mailbox at the screen refresh rate
+    FrameMailbox *frameMailbox;
+    QTimer *displayTimer;
+    quint64 displayedSequence;
+
+    // Overlay items are created once and updated in place every frame
+    QGraphicsItemGroup *markersLayer;
+    QGraphicsItemGroup *selectedPointLayer;
+    QGraphicsItemGroup *distanceLayer;
+    std::vector<QGraphicsPolygonItem *> markerOutlines;
+    std::vector<QGraphicsSimpleTextItem *> markerLabels;
+    QGraphicsEllipseItem *selectedPointItem;
+    QGraphicsSimpleTextItem *distanceItem;
+
+    void updateOverlay(const FrameOverlay &overlay);
+    bool isDisplayed() const;
+
+private slots:
+    void onDisplayTimer();
 };
 
 #endif // GRAPHICSVIEWCONTAINER_H
@@ -0,0 +1,10 @@
+#include "ioworker.h"
+
+IoWorker::IoWorker()
+    : queue(TaskExecutor::instance(), TaskPriority::Normal)
+{}
+
+void IoWorker::post(std::function<void()> task)
+{
+    queue.post(std::move(task));
+}
@@ -0,0 +1,41 @@
+#ifndef IOWORKER_H
+#define IOWORKER_H
+
+#include "taskexecutor.h"
+#include <functional>
+#include <QPointer>
+
+// Runs file operations one after another on the shared executor, so the GUI
+// never waits for the disk. Tasks run in the order they were posted.
+class IoWorker
+{
+public:
+    IoWorker();
+
+    void post(std::function<void()> task);
+    // task runs on the pool, done(result) afterwards on the thread of context.
+    // done is skipped when context is gone by then.
+    template<typename Task, typename Done>
+    void post(QObject *context, Task task, Done done);
+
+    // Returns once every task posted so far has run
+    void waitForIdle() { queue.waitForIdle(); }
+
+private:
+    SerialQueue queue;
+};
+
+template<typename Task, typename Done>
+void IoWorker::post(QObject *context, Task task, Done done)
+{
+    QPointer<QObject> guard(context);
+    post([guard, task, done]() {
+        auto result = task();
+        if (guard) {
+            QMetaObject::invokeMethod(
+                guard.data(), [result, done]() { done(result); }, Qt::QueuedConnection);
+        }
+    });
+}
+
+#endif // IOWORKER_H
@@ -0,0 +1,227 @@
+#include "latencymetrics.h"
+#include <algorithm>
+#include <chrono>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+LatencyMetrics::LatencyMetrics()
+{
+    reset();
+}
+
+LatencyMetrics &LatencyMetrics::instance()
+{
+    static LatencyMetrics metrics;
+    return metrics;
+}
+
+qint64 LatencyMetrics::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+const char *LatencyMetrics::stageName(Stage stage)
+{
+    switch (stage) {
+    case Stage::CaptureWait:
+        return "capture_wait";
+    case Stage::Resize:
+        return "resize";
+    case Stage::Sharpness:
+        return "sharpness";
+    case Stage::Detect:
+        return "detect";
+    case Stage::Pose:
+        return "pnp";
+    case Stage::ConfigMatch:
+        return "config_match";
+    case Stage::Draw:
+        return "draw";
+    case Stage::Convert:
+        return "convert";
+    case Stage::QueueDelay:
+        return "queue_delay";
+    case Stage::Paint:
+        return "paint";
+    case Stage::CalibrationDetect:
+        return "calibration_detect";
+    case Stage::CalibrationSolve:
+        return "calibration_solve";
+    case Stage::Reconnect:
+        return "reconnect";
+    case Stage::Count:
+        break;
+    }
+    return "unknown";
+}
+
+void LatencyMetrics::record(Stage stage, qint64 startNs, qint64 endNs)
+{
+    qint64 duration = endNs - startNs;
+
+    StageWindow &window = windows[(size_t) stage];
+    quint64 index = window.count.fetch_add(1, std::memory_order_relaxed);
+    window.samples[index % WINDOW_SIZE].store(duration, std::memory_order_relaxed);
+
+    TraceEvent &event = trace[traceCount.fetch_add(1, std::memory_order_relaxed) % TRACE_SIZE];
+    event.stage.store((int) stage, std::memory_order_relaxed);
+    event.thread.store(
+        (quint64) reinterpret_cast<quintptr>(QThread::currentThreadId()), std::memory_order_relaxed);
+    event.start.store(startNs, std::memory_order_relaxed);
+    event.duration.store(duration, std::memory_order_relaxed);
+}
+
+void LatencyMetrics::recordFrame(int camera, qint64 startNs, qint64 endNs)
+{
+    if (camera < 0 || camera >= MAX_CAMERAS)
+        return;
+
+    CameraWindow &window = cameras[camera];
+    quint64 index = window.latency.count.fetch_add(1, std::memory_order_relaxed);
+    window.latency.samples[index % WINDOW_SIZE].store(endNs - startNs, std::memory_order_relaxed);
+    window.ends[index % WINDOW_SIZE].store(endNs, std::memory_order_relaxed);
+}
+
+void LatencyMetrics::reset()
+{
+    for (StageWindow &window : windows) {
+        window.count.store(0, std::memory_order_relaxed);
+    }
+    for (CameraWindow &window : cameras) {
+        window.latency.count.store(0, std::memory_order_relaxed);
+    }
+    traceCount.store(0, std::memory_order_relaxed);
+}
+
+std::vector<StageSummary> LatencyMetrics::summary() const
+{
+    std::vector<StageSummary> result;
+    std::vector<qint64> samples;
+    samples.reserve(WINDOW_SIZE);
+
+    for (size_t i = 0; i < windows.size(); i++) {
+        const StageWindow &window = windows[i];
+        windowSamples(window, samples);
+
+        StageSummary stageSummary{
+            (Stage) i, window.count.load(std::memory_order_relaxed), 0.0, 0.0, 0.0, 0.0};
+        if (!samples.empty()) {
+            stageSummary.p50 = percentile(samples, 0.50);
+            stageSummary.p95 = percentile(samples, 0.95);
+            stageSummary.p99 = percentile(samples, 0.99);
+            stageSummary.max = *std::max_element(samples.begin(), samples.end()) / 1e6;
+        }
+        result.push_back(stageSummary);
+    }
+    return result;
+}
+
+std::vector<CameraSummary> LatencyMetrics::cameraSummary() const
+{
+    std::vector<CameraSummary> result;
+    std::vector<qint64> samples;
+    samples.reserve(WINDOW_SIZE);
+
+    for (int i = 0; i < MAX_CAMERAS; i++) {
+        const CameraWindow &window = cameras[i];
+        quint64 count = window.latency.count.load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+        windowSamples(window.latency, samples);
+
+        CameraSummary cameraSummary{i, count, 0.0, 0.0, 0.0, 0.0};
+        quint64 available = std::min<quint64>(count, WINDOW_SIZE);
+        qint64 newest = window.ends[(count - 1) % WINDOW_SIZE].load(std::memory_order_relaxed);
+        qint64 oldest = window.ends[(count - available) % WINDOW_SIZE].load(
+            std::memory_order_relaxed);
+        if (available > 1 && newest > oldest)
+            cameraSummary.fps = (available - 1) * 1e9 / (newest - oldest);
+        cameraSummary.p50 = percentile(samples, 0.50);
+        cameraSummary.p95 = percentile(samples, 0.95);
+        cameraSummary.max = *std::max_element(samples.begin(), samples.end()) / 1e6;
+        result.push_back(cameraSummary);
+    }
+    return result;
+}
+
+void LatencyMetrics::windowSamples(const StageWindow &window, std::vector<qint64> &samples)
+{
+    quint64 count = window.count.load(std::memory_order_relaxed);
+    size_t available = (size_t) std::min<quint64>(count, WINDOW_SIZE);
+
+    samples.clear();
+    for (size_t j = 0; j < available; j++) {
+        samples.push_back(window.samples[j].load(std::memory_order_relaxed));
+    }
+}
+
+// In milliseconds, reorders the samples
+double LatencyMetrics::percentile(std::vector<qint64> &samples, double p)
+{
+    size_t k = std::min(samples.size() - 1, (size_t) (p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k] / 1e6;
+}
+
+std::vector<LatencyMetrics::TraceRecord> LatencyMetrics::traceRecords() const
+{
+    std::vector<TraceRecord> records;
+    quint64 count = traceCount.load(std::memory_order_relaxed);
+    quint64 first = count > TRACE_SIZE ? count - TRACE_SIZE : 0;
+    records.reserve((size_t) (count - first));
+
+    for (quint64 i = first; i < count; i++) {
+        const TraceEvent &event = trace[i % TRACE_SIZE];
+        records.push_back(TraceRecord{
+            (Stage) event.stage.load(std::memory_order_relaxed),
+            event.thread.load(std::memory_order_relaxed),
+            event.start.load(std::memory_order_relaxed),
+            event.duration.load(std::memory_order_relaxed)});
+    }
+
+    std::sort(records.begin(), records.end(), [](const TraceRecord &a, const TraceRecord &b) {
+        return a.start < b.start;
+    });
+    return records;
+}
+
+bool LatencyMetrics::exportCsv(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    out << "stage,thread,start_ns,duration_ns\n";
+    for (const TraceRecord &record : traceRecords()) {
+        out << stageName(record.stage) << ',' << record.thread << ',' << record.start << ','
+            << record.duration << '\n';
+    }
+    return true;
+}
+
+bool LatencyMetrics::exportChromeTrace(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    // Trace Event Format, complete events with microsecond timestamps
+    QTextStream out(&file);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (const TraceRecord &record : traceRecords()) {
+        if (!first)
+            out << ',';
+        first = false;
+        out << "{\"name\":\"" << stageName(record.stage) << "\",\"cat\":\"frame\",\"ph\":\"X\","
+            << "\"ts\":" << QString::number(record.start / 1e3, 'f', 3)
+            << ",\"dur\":" << QString::number(record.duration / 1e3, 'f', 3)
+            << ",\"pid\":1,\"tid\":" << record.thread << '}';
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}\n";
+    return true;
+}
@@ -0,0 +1,145 @@
+#ifndef LATENCYMETRICS_H
+#define LATENCYMETRICS_H
+
+#include <array>
+#include <atomic>
+#include <QString>
+#include <QtGlobal>
+#include <vector>
+
+enum class Stage {
+    CaptureWait,
+    Resize,
+    Sharpness,
+    Detect,
+    Pose,
+    ConfigMatch,
+    Draw,
+    Convert,
+    QueueDelay,
+    Paint,
+    CalibrationDetect,
+    CalibrationSolve,
+    // From the first empty read to the next good frame
+    Reconnect,
+    Count
+};
+
+struct StageSummary
+{
+    Stage stage;
+    quint64 count;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+};
+
+// Frame rate and read-to-processed latency of one camera
+struct CameraSummary
+{
+    int camera;
+    quint64 frames;
+    double fps;
+    double p50;
+    double p95;
+    double max;
+};
+
+// Process wide per-stage latency recorder. Recording is lock-free and can be
+// called from any thread; every stage keeps a rolling window of the latest
+// samples for percentiles and a shared ring of events for trace export.
+class LatencyMetrics
+{
+public:
+    static LatencyMetrics &instance();
+
+    // Monotonic timestamp in nanoseconds
+    static qint64 now();
+    static const char *stageName(Stage stage);
+
+    void record(Stage stage, qint64 startNs, qint64 endNs);
+    // One processed frame of a camera, from the end of the read to the end of its stage
+    void recordFrame(int camera, qint64 startNs, qint64 endNs);
+    void reset();
+
+    // Percentiles are in milliseconds over the rolling window
+    std::vector<StageSummary> summary() const;
+    // Only cameras that have processed frames are listed
+    std::vector<CameraSummary> cameraSummary() const;
+    bool exportCsv(const QString &fileName) const;
+    bool exportChromeTrace(const QString &fileName) const;
+
+    static constexpr int MAX_CAMERAS = 8;
+
+private:
+    LatencyMetrics();
+
+    static constexpr size_t WINDOW_SIZE = 1024;
+    static constexpr size_t TRACE_SIZE = 16384;
+
+    struct StageWindow
+    {
+        std::array<std::atomic<qint64>, WINDOW_SIZE> samples;
+        std::atomic<quint64> count;
+    };
+
+    struct CameraWindow
+    {
+        StageWindow latency;
+        // End of every sample, the frame rate is taken over the window
+        std::array<std::atomic<qint64>, WINDOW_SIZE> ends;
+    };
+
+    struct TraceEvent
+    {
+        std::atomic<int> stage;
+        std::atomic<quint64> thread;
+        std::atomic<qint64> start;
+        std::atomic<qint64> duration;
+    };
+
+    struct TraceRecord
+    {
+        Stage stage;
+        quint64 thread;
+        qint64 start;
+        qint64 duration;
+    };
+
+    std::array<StageWindow, (size_t) Stage::Count> windows;
+    std::array<CameraWindow, MAX_CAMERAS> cameras;
+    std::array<TraceEvent, TRACE_SIZE> trace;
+    std::atomic<quint64> traceCount;
+
+    std::vector<TraceRecord> traceRecords() const;
+    static void windowSamples(const StageWindow &window, std::vector<qint64> &samples);
+    static double percentile(std::vector<qint64> &samples, double p);
+};
+
+// Records the time between construction and destruction (or stop()) as a stage
+class ScopedStageTimer
+{
+public:
+    explicit ScopedStageTimer(Stage stage)
+        : stage(stage)
+        , start(LatencyMetrics::now())
+        , stopped(false)
+    {}
+    ~ScopedStageTimer() { stop(); }
+
+    void stop()
+    {
+        if (!stopped) {
+            LatencyMetrics::instance().record(stage, start, LatencyMetrics::now());
+            stopped = true;
+        }
+    }
+
+private:
+    Stage stage;
+    qint64 start;
+    bool stopped;
+};
+
+#endif // LATENCYMETRICS_H
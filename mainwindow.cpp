@@ -1,10 +1,14 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include <QActionGroup>
 #include <QDateTime>
 #include <QDebug>
 #include <QFileDialog>
+#include <QMenu>
+#include <QMenuBar>
 #include <QMessageBox>
 #include <QShortcut>
+#include <QStatusBar>
 #include <QUuid>
 
 MainWindow::MainWindow(QWidget *parent)
@@ -13,14 +17,28 @@ MainWindow::MainWindow(QWidget *parent)
     , workspace(new Workspace(this))
     , graphicsViewContainer(new GraphicsViewContainer(this))
     , configurationsWidget(new ConfigurationsWidget(this))
+    , detectorSettingsWidget(new DetectorSettingsWidget(this))
 {
     ui->setupUi(this);
     resize(1180, 560);
 
     ui->cameraLayout->addWidget(graphicsViewContainer);
     ui->editorLayout->addWidget(configurationsWidget);
+    ui->toolBox->addItem(detectorSettingsWidget, tr("Detector settings"));
     ui->toolBox->setCurrentIndex(0);
 
+    // Latency metrics, hidden until requested from the View menu
+    metricsDock = new QDockWidget(tr("Latency metrics"), this);
+    metricsDock->setWidget(new MetricsWidget(metricsDock));
+    addDockWidget(Qt::RightDockWidgetArea, metricsDock);
+    metricsDock->hide();
+    QMenu *viewMenu = menuBar()->addMenu(tr("View"));
+    viewMenu->addAction(metricsDock->toggleViewAction());
+    viewMenu->addSeparator();
+    addOverlayAction(viewMenu, tr("Marker outlines"), OverlayLayer::Markers);
+    addOverlayAction(viewMenu, tr("Selected point"), OverlayLayer::SelectedPoint);
+    addOverlayAction(viewMenu, tr("Distance"), OverlayLayer::Distance);
+
     // Shortcuts
     QShortcut *captuteFrameShortcut = new QShortcut(Qt::Key_Space, ui->captureButton);
 
@@ -62,6 +80,21 @@ MainWindow::MainWindow(QWidget *parent)
         &ConfigurationsWidget::removeConfiguration,
         workspace,
         &Workspace::removeConfiguration);
+    connect(
+        detectorSettingsWidget,
+        &DetectorSettingsWidget::settingsChanged,
+        workspace,
+        &Workspace::setDetectorSettings);
+    connect(
+        detectorSettingsWidget,
+        &DetectorSettingsWidget::loadProfile,
+        workspace,
+        &Workspace::loadDetectorProfile);
+    connect(
+        detectorSettingsWidget,
+        &DetectorSettingsWidget::saveProfile,
+        workspace,
+        &Workspace::saveDetectorProfile);
     connect(
         ui->selectCalibrationFileButton,
         &QPushButton::clicked,
@@ -69,11 +102,6 @@ MainWindow::MainWindow(QWidget *parent)
         &MainWindow::onSelectCalibrationFileButton);
 
     // Connects to MainWindow
-    connect(
-        workspace,
-        &Workspace::frameReady,
-        graphicsViewContainer,
-        &GraphicsViewContainer::updateFrame);
     connect(workspace, &Workspace::taskFinished, this, &MainWindow::onTaskFinished);
     connect(
         workspace,
@@ -84,10 +112,43 @@ MainWindow::MainWindow(QWidget *parent)
     connect(workspace, &Workspace::configurationsUpdated, this, &MainWindow::onCofigurationsUpdated);
     connect(workspace, &Workspace::calibrationUpdated, this, &MainWindow::onCalibrationUpdated);
     connect(workspace, &Workspace::frameCaptured, this, &MainWindow::onFrameCaptured);
+    connect(workspace, &Workspace::imagesBusy, this, [this](bool busy) {
+        ui->captureButton->setEnabled(!busy);
+        ui->calibrateButton->setEnabled(!busy);
+    });
+    connect(
+        workspace,
+        &Workspace::detectorSettingsUpdated,
+        detectorSettingsWidget,
+        &DetectorSettingsWidget::setSettings);
+    connect(
+        workspace,
+        &Workspace::detectionStats,
+        detectorSettingsWidget,
+        &DetectorSettingsWidget::onDetectionStats);
+    connect(
+        workspace,
+        &Workspace::sharpnessStats,
+        detectorSettingsWidget,
+        &DetectorSettingsWidget::onSharpnessStats);
 
     // Other tasks
+    connect(workspace, &Workspace::activeCameraChanged, this, [this]() {
+        graphicsViewContainer->setFrameMailbox(workspace->getFrameMailbox());
+    });
+    graphicsViewContainer->setFrameMailbox(workspace->getFrameMailbox());
+    addCameraMenu();
+
+    // The device may only open, or reopen in another mode, after start
+    captureModeLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(captureModeLabel);
+    captureModeTimer = new QTimer(this);
+    connect(captureModeTimer, &QTimer::timeout, this, &MainWindow::updateCaptureMode);
+    connect(workspace, &Workspace::activeCameraChanged, this, &MainWindow::updateCaptureMode);
+    captureModeTimer->start(1000);
+
     workspace->init();
-    configurationsWidget->setConfigurations(workspace->getConfigurations());
+    configurationsWidget->setConfigurations(workspace->getConfigurations()->configurations);
 }
 
 MainWindow::~MainWindow()
@@ -109,6 +170,35 @@ void MainWindow::mousePressEvent(QMouseEvent *event)
     QMainWindow::mousePressEvent(event);
 }
 
+void MainWindow::addOverlayAction(QMenu *menu, const QString &text, OverlayLayer layer)
+{
+    QAction *action = menu->addAction(text);
+    action->setCheckable(true);
+    action->setChecked(true);
+    connect(action, &QAction::toggled, this, [this, layer](bool checked) {
+        graphicsViewContainer->setLayerVisible(layer, checked);
+    });
+}
+
+// Only stations with several cameras get to choose
+void MainWindow::addCameraMenu()
+{
+    if (workspace->cameraCount() < 2)
+        return;
+
+    QMenu *cameraMenu = menuBar()->addMenu(tr("Camera"));
+    QActionGroup *cameraGroup = new QActionGroup(cameraMenu);
+    for (int camera = 0; camera < workspace->cameraCount(); camera++) {
+        QAction *action = cameraMenu->addAction(tr("Camera %1").arg(camera + 1));
+        action->setCheckable(true);
+        action->setChecked(camera == workspace->getActiveCamera());
+        cameraGroup->addAction(action);
+        connect(action, &QAction::triggered, workspace, [this, camera]() {
+            workspace->setActiveCamera(camera);
+        });
+    }
+}
+
 Configuration MainWindow::formConfiguration()
 {
     Configuration newConfiguration{};
@@ -165,7 +255,7 @@ void MainWindow::onSaveSingleConfiguration()
 
 void MainWindow::onCofigurationsUpdated()
 {
-    configurationsWidget->setConfigurations(workspace->getConfigurations());
+    configurationsWidget->setConfigurations(workspace->getConfigurations()->configurations);
 }
 
 void MainWindow::onCalibrationUpdated(bool status)
@@ -195,3 +285,26 @@ void MainWindow::onSelectCalibrationFileButton()
         this, tr("Select calibration file"), QString(), tr("YAML files (*.yml)"));
     emit selectCalibrationFile(fileName);
 }
+
+void MainWindow::updateCaptureMode()
+{
+    CaptureMode mode = workspace->getCaptureMode();
+    if (mode.deviceSize.empty()) {
+        captureModeLabel->setText(
+            tr("Camera %1: not opened").arg(workspace->getActiveCamera() + 1));
+        return;
+    }
+
+    QString text = tr("Camera %1: %2x%3 %4, %5 fps")
+                       .arg(workspace->getActiveCamera() + 1)
+                       .arg(mode.deviceSize.width)
+                       .arg(mode.deviceSize.height)
+                       .arg(QString::fromStdString(mode.pixelFormat))
+                       .arg(mode.fps, 0, 'f', 0);
+    if (mode.processingSize != mode.deviceSize) {
+        text += tr(", scaled to %1x%2")
+                    .arg(mode.processingSize.width)
+                    .arg(mode.processingSize.height);
+    }
+    captureModeLabel->setText(text);
+}
@@ -2,11 +2,17 @@
 #define MAINWINDOW_H
 
 #include "configurationswidget.h"
+#include "detectorsettingswidget.h"
 #include "graphicsviewcontainer.h"
+#include "metricswidget.h"
 #include "workspace.h"
 #include "yamlhandler.h"
+#include <QDockWidget>
+#include <QLabel>
 #include <QMainWindow>
+#include <QMenu>
 #include <QMouseEvent>
+#include <QTimer>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -37,8 +43,14 @@ private:
     Workspace *workspace;
     GraphicsViewContainer *graphicsViewContainer;
     ConfigurationsWidget *configurationsWidget;
+    DetectorSettingsWidget *detectorSettingsWidget;
+    QDockWidget *metricsDock;
+    QLabel *captureModeLabel;
+    QTimer *captureModeTimer;
 
     Configuration formConfiguration();
+    void addOverlayAction(QMenu *menu, const QString &text, OverlayLayer layer);
+    void addCameraMenu();
 
 private slots:
     void onTaskFinished(bool success, const QString &message);
@@ -51,6 +63,7 @@ private slots:
     void onFrameCaptured(int num);
     void onExportConfiguration();
     void onSelectCalibrationFileButton();
+    void updateCaptureMode();
 };
 
 #endif // MAINWINDOW_H
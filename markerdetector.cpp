@@ -0,0 +1,254 @@
+#include "markerdetector.h"
+#include "taskexecutor.h"
+#include <cmath>
+#include <set>
+
+MarkerDetector::MarkerDetector()
+    : markerSize(55.0f)
+{
+    dictionary = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250);
+    rebuildDetector();
+    updateObjectPoints();
+}
+
+void MarkerDetector::setDetectorSettings(const DetectorSettings &newSettings)
+{
+    settings = newSettings;
+    rebuildDetector();
+}
+
+void MarkerDetector::setKnownMarkerIds(const std::vector<int> &ids)
+{
+    knownMarkerIds = ids;
+    if (settings.useReducedDictionary) {
+        rebuildDetector();
+    }
+}
+
+void MarkerDetector::setMarkerSize(float size)
+{
+    markerSize = size;
+    updateObjectPoints();
+}
+
+void MarkerDetector::setCalibrationParams(const CalibrationParams &params)
+{
+    calibrationParams = params;
+}
+
+void MarkerDetector::detect(const cv::Mat &image, MarkerDetections &detections)
+{
+    detections.markerIds.clear();
+    detections.markerCorners.clear();
+    detections.rvecs.clear();
+    detections.tvecs.clear();
+
+    if (settings.tileMarkerSize > 0) {
+        updateTiles(image.size());
+    }
+    if (settings.tileMarkerSize > 0 && !tiles.empty()) {
+        detectTiles(image, detections);
+    } else {
+        detectRegion(-1, image, detections.markerCorners, detections.markerIds);
+    }
+    if (!dictionaryIds.empty()) {
+        for (int &id : detections.markerIds) {
+            id = dictionaryIds[id];
+        }
+    }
+}
+
+void MarkerDetector::estimatePoses(MarkerDetections &detections)
+{
+    size_t nMarkers = detections.markerCorners.size();
+    detections.rvecs.resize(nMarkers);
+    detections.tvecs.resize(nMarkers);
+
+    auto solve = [this, &detections](int i) {
+        solvePnP(
+            objPoints,
+            detections.markerCorners.at(i),
+            calibrationParams.cameraMatrix,
+            calibrationParams.distCoeffs,
+            detections.rvecs.at(i),
+            detections.tvecs.at(i));
+    };
+
+    // A handful of markers is solved faster than the pool can be woken
+    if (nMarkers < PARALLEL_POSE_MIN_MARKERS) {
+        for (size_t i = 0; i < nMarkers; i++) {
+            solve(i);
+        }
+    } else {
+        TaskExecutor::instance().parallelFor(nMarkers, solve);
+    }
+}
+
+void MarkerDetector::rebuildDetector()
+{
+    detectorParams = settings.toDetectorParameters();
+
+    dictionaryIds.clear();
+    if (settings.useReducedDictionary) {
+        std::set<int> usedIds;
+        for (int id : knownMarkerIds) {
+            if (id >= 0 && id < dictionary.bytesList.rows)
+                usedIds.insert(id);
+        }
+        dictionaryIds.assign(usedIds.begin(), usedIds.end());
+    }
+
+    // Without known blocks there is nothing to reduce to, keep detecting everything
+    detectorDictionary = dictionaryIds.empty() ? dictionary
+                                               : buildReducedDictionary(dictionaryIds);
+    detector = cv::aruco::ArucoDetector(detectorDictionary, detectorParams);
+    fusedDetector = FusedMarkerDetector(detectorDictionary, detectorParams);
+    useFusedDetector = settings.useFusedThreshold
+                       && FusedMarkerDetector::supports(detectorParams);
+
+    // Tiles are laid out again for the next frame
+    tiledImageSize = cv::Size();
+    tiles.clear();
+    tileDetectors.clear();
+    tileFusedDetectors.clear();
+}
+
+void MarkerDetector::updateTiles(const cv::Size &imageSize)
+{
+    if (imageSize == tiledImageSize)
+        return;
+    tiledImageSize = imageSize;
+    tiles.clear();
+    tileDetectors.clear();
+    tileFusedDetectors.clear();
+
+    // A marker rotated by 45 degrees spans its side times sqrt(2). With that
+    // much overlap plus a margin on both sides every marker lies whole inside
+    // at least one tile, away from its edges.
+    int margin = std::max(TILE_MIN_MARGIN, detectorParams.adaptiveThreshWinSizeMax);
+    int overlap = (int) std::ceil(settings.tileMarkerSize * 1.5) + 2 * margin;
+
+    // About one tile per pool thread, tiles narrower than the overlap would
+    // mostly detect the same pixels twice
+    int threads = TaskExecutor::instance().threadCount();
+    int cols = (int) std::lround(
+        std::sqrt((double) threads * imageSize.width / std::max(1, imageSize.height)));
+    cols = std::max(1, std::min(cols, imageSize.width / overlap));
+    int rows = (threads + cols - 1) / cols;
+    rows = std::max(1, std::min(rows, imageSize.height / overlap));
+    if (cols * rows < 2)
+        return;
+
+    int stepX = (imageSize.width + cols - 1) / cols;
+    int stepY = (imageSize.height + rows - 1) / rows;
+    int maxSide = std::max(imageSize.width, imageSize.height);
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < cols; col++) {
+            cv::Rect tile(col * stepX, row * stepY, stepX + overlap, stepY + overlap);
+            tile &= cv::Rect(cv::Point(), imageSize);
+            tiles.push_back(tile);
+
+            // Perimeter limits are relative to the larger image side, scaled so
+            // they stay the same in pixels
+            double scale = (double) maxSide / std::max(tile.width, tile.height);
+            cv::aruco::DetectorParameters tileParams = detectorParams;
+            tileParams.minMarkerPerimeterRate *= scale;
+            tileParams.maxMarkerPerimeterRate *= scale;
+            tileDetectors.emplace_back(detectorDictionary, tileParams);
+            tileFusedDetectors.emplace_back(detectorDictionary, tileParams);
+        }
+    }
+}
+
+void MarkerDetector::detectTiles(const cv::Mat &image, MarkerDetections &detections)
+{
+    std::vector<std::vector<int>> tileIds(tiles.size());
+    std::vector<std::vector<std::vector<cv::Point2f>>> tileCorners(tiles.size());
+
+    TaskExecutor::instance().parallelFor((int) tiles.size(), [&](int i) {
+        detectRegion(i, image(tiles[i]), tileCorners[i], tileIds[i]);
+        cv::Point2f offset(tiles[i].x, tiles[i].y);
+        for (std::vector<cv::Point2f> &corners : tileCorners[i]) {
+            for (cv::Point2f &corner : corners) {
+                corner += offset;
+            }
+        }
+    });
+
+    // Markers in the overlap are found by several tiles, the same id with the
+    // center closer than half a side is one marker
+    std::vector<cv::Point2f> centers;
+    for (size_t i = 0; i < tiles.size(); i++) {
+        for (size_t j = 0; j < tileIds[i].size(); j++) {
+            const std::vector<cv::Point2f> &corners = tileCorners[i][j];
+            cv::Point2f center = (corners[0] + corners[1] + corners[2] + corners[3]) / 4.f;
+            float halfSide = (float) cv::arcLength(corners, true) / 8.f;
+
+            bool duplicate = false;
+            for (size_t k = 0; k < detections.markerIds.size() && !duplicate; k++) {
+                duplicate = detections.markerIds[k] == tileIds[i][j]
+                            && cv::norm(centers[k] - center) < halfSide;
+            }
+            if (duplicate)
+                continue;
+            detections.markerIds.push_back(tileIds[i][j]);
+            detections.markerCorners.push_back(corners);
+            centers.push_back(center);
+        }
+    }
+}
+
+void MarkerDetector::detectRegion(
+    int tile,
+    const cv::Mat &image,
+    std::vector<std::vector<cv::Point2f>> &corners,
+    std::vector<int> &ids) const
+{
+    if (useFusedDetector) {
+        (tile < 0 ? fusedDetector : tileFusedDetectors[tile]).detectMarkers(image, corners, ids);
+    } else {
+        std::vector<std::vector<cv::Point2f>> rejectedCorners;
+        const cv::aruco::ArucoDetector &regionDetector = tile < 0 ? detector : tileDetectors[tile];
+        regionDetector.detectMarkers(image, corners, ids, rejectedCorners);
+    }
+}
+
+void MarkerDetector::updateObjectPoints()
+{
+    objPoints = cv::Mat(4, 1, CV_32FC3);
+    objPoints.ptr<cv::Vec3f>(0)[0] = cv::Vec3f(-markerSize / 2.f, markerSize / 2.f, 0);
+    objPoints.ptr<cv::Vec3f>(0)[1] = cv::Vec3f(markerSize / 2.f, markerSize / 2.f, 0);
+    objPoints.ptr<cv::Vec3f>(0)[2] = cv::Vec3f(markerSize / 2.f, -markerSize / 2.f, 0);
+    objPoints.ptr<cv::Vec3f>(0)[3] = cv::Vec3f(-markerSize / 2.f, -markerSize / 2.f, 0);
+}
+
+cv::aruco::Dictionary MarkerDetector::buildReducedDictionary(const std::vector<int> &ids)
+{
+    cv::Mat bytesList;
+    for (int id : ids) {
+        bytesList.push_back(dictionary.bytesList.row(id));
+    }
+    cv::aruco::Dictionary reduced(bytesList, dictionary.markerSize, dictionary.maxCorrectionBits);
+
+    // Fewer markers are further apart from each other, so more bits can be corrected
+    int minDistance = dictionary.markerSize * dictionary.markerSize;
+    for (int i = 0; i < reduced.bytesList.rows; i++) {
+        cv::Mat bits = cv::aruco::Dictionary::getBitsFromByteList(
+            reduced.bytesList.row(i), reduced.markerSize);
+        for (int j = 0; j < reduced.bytesList.rows; j++) {
+            if (j != i)
+                minDistance = std::min(minDistance, reduced.getDistanceToId(bits, j, true));
+        }
+        // A marker must also stay distinguishable from its own rotations
+        cv::Mat rotated = bits.clone();
+        for (int r = 0; r < 3; r++) {
+            cv::Mat next;
+            cv::rotate(rotated, next, cv::ROTATE_90_CLOCKWISE);
+            rotated = next;
+            minDistance = std::min(minDistance, reduced.getDistanceToId(rotated, i, false));
+        }
+    }
+    reduced.maxCorrectionBits = std::max(dictionary.maxCorrectionBits, (minDistance - 1) / 2);
+
+    return reduced;
+}
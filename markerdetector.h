@@ -0,0 +1,79 @@
+#ifndef MARKERDETECTOR_H
+#define MARKERDETECTOR_H
+
+#include "fusedmarkerdetector.h"
+#include "yamlhandler.h"
+#include <opencv2/aruco.hpp>
+#include <opencv2/opencv.hpp>
+
+// Markers found in one frame and, after estimatePoses(), their poses
+// relative to the camera
+struct MarkerDetections
+{
+    std::vector<int> markerIds;
+    std::vector<std::vector<cv::Point2f>> markerCorners;
+    std::vector<cv::Vec3d> rvecs;
+    std::vector<cv::Vec3d> tvecs;
+};
+
+// ArUco detection and per-marker pose estimation used by the tracker.
+// Not thread-safe, each thread needs its own instance.
+class MarkerDetector
+{
+public:
+    MarkerDetector();
+
+    void setDetectorSettings(const DetectorSettings &settings);
+    void setKnownMarkerIds(const std::vector<int> &ids);
+    void setMarkerSize(float size);
+    void setCalibrationParams(const CalibrationParams &params);
+
+    const DetectorSettings &getDetectorSettings() const { return settings; }
+    const cv::aruco::Dictionary &getDictionary() const { return dictionary; }
+
+    void detect(const cv::Mat &image, MarkerDetections &detections);
+    void estimatePoses(MarkerDetections &detections);
+
+private:
+    static constexpr size_t PARALLEL_POSE_MIN_MARKERS = 8;
+    // Pixels kept between a marker and the tile edge, at least the largest
+    // threshold window is used so pixels near the marker threshold the same
+    static constexpr int TILE_MIN_MARGIN = 8;
+
+    cv::aruco::Dictionary dictionary;
+    cv::aruco::ArucoDetector detector;
+    FusedMarkerDetector fusedDetector;
+    // Settings ask for the fused detector and it supports the parameters
+    bool useFusedDetector = false;
+    // Dictionary and parameters of the detector, the tile detectors are built from them
+    cv::aruco::Dictionary detectorDictionary;
+    cv::aruco::DetectorParameters detectorParams;
+    DetectorSettings settings;
+    std::vector<int> knownMarkerIds;
+    // Real marker ids of the reduced dictionary, empty when the full one is used
+    std::vector<int> dictionaryIds;
+
+    // Tile layout of the last image size, empty when the frame is detected whole
+    cv::Size tiledImageSize;
+    std::vector<cv::Rect> tiles;
+    std::vector<cv::aruco::ArucoDetector> tileDetectors;
+    std::vector<FusedMarkerDetector> tileFusedDetectors;
+
+    float markerSize;
+    cv::Mat objPoints;
+    CalibrationParams calibrationParams;
+
+    void rebuildDetector();
+    void updateTiles(const cv::Size &imageSize);
+    void detectTiles(const cv::Mat &image, MarkerDetections &detections);
+    // Whole image with tile < 0
+    void detectRegion(
+        int tile,
+        const cv::Mat &image,
+        std::vector<std::vector<cv::Point2f>> &corners,
+        std::vector<int> &ids) const;
+    void updateObjectPoints();
+    cv::aruco::Dictionary buildReducedDictionary(const std::vector<int> &ids);
+};
+
+#endif // MARKERDETECTOR_H
@@ -0,0 +1,412 @@
+#include "markerstage.h"
+#include "latencymetrics.h"
+#include "trackingstream.h"
+#include <QDebug>
+#include <QPointF>
+
+MarkerStage::MarkerStage(QObject *parent)
+    : QObject{parent}
+    , frameMailbox(nullptr)
+    , resultStream(nullptr)
+    , camera(0)
+    , commands(256)
+    , minSharpness(0.0)
+    , skippedFrames(0)
+    , configurations(std::make_shared<const ConfigurationSnapshot>())
+{}
+
+void MarkerStage::setConfigurations(ConfigurationSnapshotPtr snapshot)
+{
+    // Only the pointer travels, the tracker never waits for the library
+    MarkerCommand command;
+    command.type = MarkerCommand::Type::SetConfigurations;
+    command.configurations = std::move(snapshot);
+    pushCommand(std::move(command));
+}
+
+void MarkerStage::setResultStream(TrackingStream *stream, int cameraIndex)
+{
+    resultStream = stream;
+    camera = cameraIndex;
+}
+
+void MarkerStage::setCalibrationParams(const CalibrationParams &params)
+{
+    // Deep copy, so later reloads on the GUI side never touch the tracker's matrices
+    MarkerCommand command;
+    command.type = MarkerCommand::Type::SetCalibrationParams;
+    command.calibrationParams.cameraMatrix = params.cameraMatrix.clone();
+    command.calibrationParams.distCoeffs = params.distCoeffs.clone();
+    pushCommand(std::move(command));
+}
+
+void MarkerStage::setDetectorSettings(const DetectorSettings &settings)
+{
+    MarkerCommand command;
+    command.type = MarkerCommand::Type::SetDetectorSettings;
+    command.detectorSettings = settings;
+    pushCommand(std::move(command));
+}
+
+Configuration MarkerStage::getCurrConfiguration() const
+{
+    std::shared_ptr<const MarkerFrameResult> result = latestResult();
+    return result ? result->currentConfiguration : Configuration{};
+}
+
+std::shared_ptr<const MarkerFrameResult> MarkerStage::latestResult() const
+{
+    return std::atomic_load(&publishedResult);
+}
+
+void MarkerStage::process(const CameraFrame &frame)
+{
+    qint64 captureTime = LatencyMetrics::now();
+    processCommands();
+
+    // Luma already comes at the processing size and in a buffer of its own,
+    // colour is made for display in finishFrame()
+    if (frame.sharpness() < minSharpness) {
+        detection.skip(captureTime, frame);
+    } else {
+        detection.submit(frame.luma(), captureTime, frame);
+    }
+
+    DetectionJob job;
+    while (detection.takeFinished(job)) {
+        finishFrame(job);
+    }
+}
+
+void MarkerStage::finishFrame(DetectionJob &job)
+{
+    if (job.skipped) {
+        // Blurred corners would only add noise, the last sharp pose is kept
+        skippedFrames++;
+    } else {
+        updateMarkers(job);
+    }
+    emit sharpnessStats(job.frame.sharpness(), skippedFrames);
+
+    if (frameMailbox && frameMailbox->isActive()) {
+        ScopedStageTimer timer(Stage::Convert);
+        QImage image = displayPool.convert(job.frame, job.frame.size());
+        timer.stop();
+        frameMailbox->post(image, overlay, LatencyMetrics::now());
+    }
+    LatencyMetrics::instance().recordFrame(camera, job.captureTime, LatencyMetrics::now());
+}
+
+void MarkerStage::updateMarkers(DetectionJob &job)
+{
+    markerPoints.clear();
+
+    MarkerDetections &detections = job.detections;
+    overlay = FrameOverlay();
+    LatencyMetrics::instance().record(Stage::Detect, job.detectStart, job.detectEnd);
+    markerIds = detections.markerIds;
+    emit detectionStats((job.detectEnd - job.detectStart) / 1e6, (int) markerIds.size());
+
+    if (markerIds.size() > 0) {
+        rvecs = detections.rvecs;
+        tvecs = detections.tvecs;
+        for (size_t i = 0; i < markerIds.size(); i++) {
+            markerPoints.push_back(
+                std::make_pair(detections.markerCorners[i][0], cv::Point3f(tvecs[i])));
+        }
+
+        {
+            ScopedStageTimer timer(Stage::ConfigMatch);
+            updateSelectedPointPosition();
+        }
+
+        ScopedStageTimer drawTimer(Stage::Draw);
+        for (size_t i = 0; i < markerIds.size(); i++) {
+            QPolygonF corners;
+            for (const cv::Point2f &corner : detections.markerCorners[i]) {
+                corners << QPointF(corner.x, corner.y);
+            }
+            overlay.markers.push_back(OverlayMarker{markerIds[i], corners});
+        }
+
+        // 3D point to 2D
+        if (selectedPoint != cv::Point3f(0.0, 0.0, 0.0) && !currentConfiguration.name.empty()) {
+            qDebug() << "X: " << selectedPoint.x;
+            qDebug() << "Y: " << selectedPoint.y;
+            qDebug() << "Distance: " << selectedPoint.z;
+            std::vector<cv::Point3f> points3D = {selectedPoint};
+            std::vector<cv::Point2f> points2D;
+            cv::projectPoints(
+                points3D,
+                cv::Vec3d::zeros(),
+                cv::Vec3d::zeros(),
+                calibrationParams.cameraMatrix,
+                calibrationParams.distCoeffs,
+                points2D);
+
+            double distance = std::sqrt(
+                selectedPoint.x * selectedPoint.x + selectedPoint.y * selectedPoint.y
+                + selectedPoint.z * selectedPoint.z);
+            overlay.hasSelectedPoint = true;
+            overlay.selectedPoint = QPointF(points2D[0].x, points2D[0].y);
+            overlay.distanceText = QString("DISTANCE: %1 mm").arg(distance);
+        }
+    } else {
+        rvecs.clear();
+        tvecs.clear();
+        ScopedStageTimer timer(Stage::ConfigMatch);
+        detectCurrentConfiguration();
+    }
+    publishResult();
+}
+
+void MarkerStage::onPointSelected(const QPointF &point)
+{
+    MarkerCommand command;
+    command.type = MarkerCommand::Type::SelectPoint;
+    command.point = cv::Point2f(point.x(), point.y());
+    pushCommand(std::move(command));
+}
+
+void MarkerStage::setMarkerSize(int size)
+{
+    MarkerCommand command;
+    command.type = MarkerCommand::Type::SetMarkerSize;
+    command.markerSize = (float) size;
+    pushCommand(std::move(command));
+}
+
+void MarkerStage::pushCommand(MarkerCommand command)
+{
+    if (!commands.tryPush(std::move(command))) {
+        qWarning() << "Marker stage command queue is full, command dropped";
+    }
+}
+
+void MarkerStage::processCommands()
+{
+    MarkerCommand command;
+    while (commands.tryPop(command)) {
+        switch (command.type) {
+        case MarkerCommand::Type::SelectPoint:
+            selectPoint(command.point);
+            break;
+        case MarkerCommand::Type::SetMarkerSize:
+            detection.setMarkerSize(command.markerSize);
+            break;
+        case MarkerCommand::Type::SetCalibrationParams:
+            calibrationParams = command.calibrationParams;
+            detection.setCalibrationParams(calibrationParams);
+            break;
+        case MarkerCommand::Type::SetConfigurations: {
+            configurations = std::move(command.configurations);
+            unsavedConfigurations.clear();
+            currentConfiguration.clear();
+            std::vector<int> knownMarkerIds;
+            for (const auto &config : configurations->configurations) {
+                knownMarkerIds.insert(
+                    knownMarkerIds.end(),
+                    config.second.markerIds.begin(),
+                    config.second.markerIds.end());
+            }
+            detection.setKnownMarkerIds(knownMarkerIds);
+            break;
+        }
+        case MarkerCommand::Type::SetDetectorSettings:
+            detection.setWorkers(command.detectorSettings.detectionWorkers);
+            detection.setDetectorSettings(command.detectorSettings);
+            minSharpness = command.detectorSettings.minSharpness;
+            break;
+        }
+    }
+}
+
+void MarkerStage::publishResult()
+{
+    auto result = std::make_shared<MarkerFrameResult>();
+    result->camera = camera;
+    result->timestamp = LatencyMetrics::now();
+    result->markerIds = markerIds;
+    result->rvecs = rvecs;
+    result->tvecs = tvecs;
+    result->markerPoints = markerPoints;
+    result->currentConfiguration = currentConfiguration;
+    result->selectedPoint = selectedPoint;
+    std::shared_ptr<const MarkerFrameResult> published(std::move(result));
+    std::atomic_store(&publishedResult, published);
+    if (resultStream)
+        resultStream->publish(std::move(published));
+}
+
+void MarkerStage::selectPoint(const cv::Point2f &clickedPoint2D)
+{
+    if (markerIds.size() != 4) {
+        emit taskFinished(false, tr("You need exactly 4 markers to create a configuration"));
+        return;
+    }
+
+    float depth = getDepthAtPoint(clickedPoint2D);
+    cv::Point3f clickedPoint3D = projectPointTo3D(clickedPoint2D, depth);
+
+    Configuration newConfig = Configuration{};
+    newConfig.markerIds = markerIds;
+    newConfig.name = currentConfiguration.name.empty() ? "New configuration"
+                                                       : currentConfiguration.name;
+
+    for (int markerId : newConfig.markerIds) {
+        auto it = std::find(markerIds.begin(), markerIds.end(), markerId);
+        if (it != markerIds.end()) {
+            int index = std::distance(markerIds.begin(), it);
+            cv::Point3f relativePoint
+                = calculateRelativePosition(clickedPoint3D, rvecs.at(index), tvecs.at(index));
+            newConfig.relativePoints[markerId] = relativePoint;
+        }
+    }
+
+    unsavedConfigurations[newConfig.name] = newConfig;
+    // This code was created to help GUI correctly update
+    Configuration tempConfig = newConfig;
+    detectCurrentConfiguration();
+    if (tempConfig.name == currentConfiguration.name) {
+        currentConfiguration = tempConfig;
+    }
+    publishResult();
+}
+
+void MarkerStage::detectCurrentConfiguration()
+{
+    Configuration new_Configuration = Configuration{};
+    auto findIn = [&](const std::map<std::string, Configuration> &candidates, bool skipUnsaved) {
+        for (const auto &config : candidates) {
+            if (skipUnsaved && unsavedConfigurations.count(config.first))
+                continue;
+            for (int id : config.second.markerIds) {
+                if (std::find(markerIds.begin(), markerIds.end(), id) != markerIds.end()) {
+                    new_Configuration = config.second;
+                    return;
+                }
+            }
+        }
+    };
+    findIn(unsavedConfigurations, false);
+    if (new_Configuration.name.empty())
+        findIn(configurations->configurations, true);
+
+    if (new_Configuration.name != currentConfiguration.name) {
+        emit newConfiguration(new_Configuration);
+        currentConfiguration = new_Configuration;
+    }
+}
+
+cv::Vec4f MarkerStage::calculateMarkersPlane(const std::vector<cv::Point3f> &marker3DPoints)
+{
+    cv::Point3f v1 = marker3DPoints[1] - marker3DPoints[0];
+    cv::Point3f v2 = marker3DPoints[2] - marker3DPoints[0];
+
+    cv::Point3f normal = v1.cross(v2);
+    float D = -(normal.dot(marker3DPoints[0]));
+
+    return cv::Vec4f(normal.x, normal.y, normal.z, D);
+}
+
+float MarkerStage::getDepthAtPoint(const cv::Point2f &point)
+{
+    cv::Mat K = calibrationParams.cameraMatrix;
+    float x = (point.x - K.at<double>(0, 2)) / K.at<double>(0, 0);
+    float y = (point.y - K.at<double>(1, 2)) / K.at<double>(1, 1);
+    cv::Point3f rayDir(x, y, 1.0f);
+
+    std::vector<cv::Point3f> marker3DPoints;
+    for (const auto &marker : markerPoints) {
+        marker3DPoints.push_back(marker.second);
+    }
+
+    cv::Vec4f plane = calculateMarkersPlane(marker3DPoints);
+
+    float numerator = -(plane[0] * 0 + plane[1] * 0 + plane[2] * 0 + plane[3]);
+    float denominator = plane[0] * rayDir.x + plane[1] * rayDir.y + plane[2] * rayDir.z;
+
+    float t = numerator / denominator;
+
+    return t;
+}
+
+cv::Point3f MarkerStage::projectPointTo3D(const cv::Point2f &point2D, float depth)
+{
+    float x = (point2D.x - calibrationParams.cameraMatrix.at<double>(0, 2))
+              / calibrationParams.cameraMatrix.at<double>(0, 0);
+    float y = (point2D.y - calibrationParams.cameraMatrix.at<double>(1, 2))
+              / calibrationParams.cameraMatrix.at<double>(1, 1);
+
+    return cv::Point3f(x * depth, y * depth, depth);
+}
+
+cv::Point3f MarkerStage::calculateRelativePosition(
+    const cv::Point3f &point3D, const cv::Vec3d &rvec, const cv::Vec3d &tvec)
+{
+    cv::Mat rotationMatrix;
+    cv::Rodrigues(rvec, rotationMatrix);
+
+    cv::Mat rotationMatrixInv = rotationMatrix.inv();
+    cv::Mat tvecInv = -rotationMatrixInv * cv::Mat(tvec);
+
+    cv::Mat pointMat = (cv::Mat_<double>(3, 1) << point3D.x, point3D.y, point3D.z);
+    cv::Mat relativePointMat = rotationMatrixInv * pointMat + tvecInv;
+
+    return cv::Point3f(
+        relativePointMat.at<double>(0),
+        relativePointMat.at<double>(1),
+        relativePointMat.at<double>(2));
+}
+
+void MarkerStage::updateSelectedPointPosition()
+{
+    detectCurrentConfiguration();
+    if (currentConfiguration.name.empty()) {
+        return;
+    }
+    const auto &config = currentConfiguration;
+    std::vector<cv::Point3f> allPoints;
+    std::vector<float> reprojectionErrors;
+
+    for (int id : config.markerIds) {
+        auto it = std::find(markerIds.begin(), markerIds.end(), id);
+        if (it != markerIds.end()) {
+            int index = std::distance(markerIds.begin(), it);
+
+            cv::Mat rotationMatrix;
+            cv::Rodrigues(rvecs.at(index), rotationMatrix);
+
+            cv::Mat relativePointMat
+                = (cv::Mat_<double>(3, 1) << config.relativePoints.at(id).x,
+                   config.relativePoints.at(id).y,
+                   config.relativePoints.at(id).z);
+            cv::Mat newPointMat = rotationMatrix * relativePointMat + cv::Mat(tvecs.at(index));
+
+            float error = cv::norm(relativePointMat - newPointMat);
+
+            allPoints.push_back(cv::Point3f(
+                newPointMat.at<double>(0), newPointMat.at<double>(1), newPointMat.at<double>(2)));
+            reprojectionErrors.push_back(error);
+        }
+    }
+
+    if (!allPoints.empty()) {
+        selectedPoint = calculateWeightedAveragePoint(allPoints, reprojectionErrors);
+    }
+}
+
+cv::Point3f MarkerStage::calculateWeightedAveragePoint(
+    const std::vector<cv::Point3f> &points, const std::vector<float> &errors)
+{
+    cv::Point3f weightedSum(0, 0, 0);
+    float totalWeight = 0.0f;
+
+    for (size_t i = 0; i < points.size(); i++) {
+        float weight = 1.0f / (errors[i] + 1e-5);
+        weightedSum += points[i] * weight;
+        totalWeight += weight;
+    }
+
+    return weightedSum / totalWeight;
+}
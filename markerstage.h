@@ -0,0 +1,133 @@
+#ifndef MARKERSTAGE_H
+#define MARKERSTAGE_H
+
+#include "configurationrepository.h"
+#include "detectionpipeline.h"
+#include "displayframepool.h"
+#include "framemailbox.h"
+#include "framestage.h"
+#include "lockfreequeue.h"
+#include "yamlhandler.h"
+#include <memory>
+#include <opencv2/aruco.hpp>
+#include <opencv2/opencv.hpp>
+#include <QObject>
+
+class TrackingStream;
+
+// Immutable result of one processed frame. A new instance is published after
+// every frame, readers get it with MarkerStage::latestResult()
+struct MarkerFrameResult
+{
+    int camera = 0;
+    qint64 timestamp = 0;
+    std::vector<int> markerIds;
+    std::vector<cv::Vec3d> rvecs;
+    std::vector<cv::Vec3d> tvecs;
+    std::vector<std::pair<cv::Point2f, cv::Point3f>> markerPoints;
+    Configuration currentConfiguration;
+    cv::Point3f selectedPoint;
+};
+
+// Request from another thread, applied by the tracking loop between frames
+struct MarkerCommand
+{
+    enum class Type {
+        SelectPoint,
+        SetMarkerSize,
+        SetCalibrationParams,
+        SetConfigurations,
+        SetDetectorSettings
+    };
+
+    Type type = Type::SelectPoint;
+    cv::Point2f point;
+    float markerSize = 0.0f;
+    CalibrationParams calibrationParams;
+    DetectorSettings detectorSettings;
+    ConfigurationSnapshotPtr configurations;
+};
+
+// Tracking mode: detects markers, matches them to known blocks and draws the
+// overlay. Everything below process() runs on the capture thread, other
+// threads talk to it through the command queue. Detection of consecutive
+// frames may overlap on the pool, matching and publishing see the frames in
+// capture order.
+class MarkerStage : public QObject, public FrameStage
+{
+    Q_OBJECT
+public:
+    explicit MarkerStage(QObject *parent = nullptr);
+
+    void setConfigurations(ConfigurationSnapshotPtr snapshot);
+    void setCalibrationParams(const CalibrationParams &params);
+    void setDetectorSettings(const DetectorSettings &settings);
+    void setFrameMailbox(FrameMailbox *mailbox) { frameMailbox = mailbox; }
+    // Results are also merged into stream under this camera, set before capture starts
+    void setResultStream(TrackingStream *stream, int cameraIndex);
+    Configuration getCurrConfiguration() const;
+    std::shared_ptr<const MarkerFrameResult> latestResult() const;
+
+    void process(const CameraFrame &frame) override;
+
+signals:
+    void newConfiguration(const Configuration &config);
+    void taskFinished(bool success, const QString &message);
+    void detectionStats(double detectMs, int markerCount);
+    // Every frame, skippedFrames counts those too blurred to detect since start
+    void sharpnessStats(double sharpness, int skippedFrames);
+
+public slots:
+    void onPointSelected(const QPointF &point);
+    void setMarkerSize(int size);
+
+private:
+    FrameMailbox *frameMailbox;
+    TrackingStream *resultStream;
+    int camera;
+
+    LockFreeQueue<MarkerCommand> commands;
+    std::shared_ptr<const MarkerFrameResult> publishedResult;
+
+    // Everything below is owned by the capture thread
+    DetectionPipeline detection;
+    DisplayFramePool displayPool;
+    double minSharpness;
+    int skippedFrames;
+    // Drawn again on skipped frames, their pose is held
+    FrameOverlay overlay;
+
+    Configuration currentConfiguration;
+    ConfigurationSnapshotPtr configurations;
+    // Blocks made by selecting a point and not saved yet, dropped with the
+    // next snapshot
+    std::map<std::string, Configuration> unsavedConfigurations;
+
+    CalibrationParams calibrationParams;
+    std::vector<int> markerIds;
+    std::vector<cv::Vec3d> rvecs;
+    std::vector<cv::Vec3d> tvecs;
+    std::vector<std::pair<cv::Point2f, cv::Point3f>> markerPoints;
+
+    cv::Point3f selectedPoint;
+
+    void pushCommand(MarkerCommand command);
+    void processCommands();
+    void finishFrame(DetectionJob &job);
+    void updateMarkers(DetectionJob &job);
+    void publishResult();
+    void selectPoint(const cv::Point2f &clickedPoint2D);
+    void detectCurrentConfiguration();
+
+    cv::Vec4f calculateMarkersPlane(const std::vector<cv::Point3f> &marker3DPoints);
+    float getDepthAtPoint(const cv::Point2f &point);
+    cv::Point3f projectPointTo3D(const cv::Point2f &point2D, float depth);
+    cv::Point3f calculateRelativePosition(
+        const cv::Point3f &point3D, const cv::Vec3d &rvec, const cv::Vec3d &tvec);
+
+    void updateSelectedPointPosition();
+    cv::Point3f calculateWeightedAveragePoint(
+        const std::vector<cv::Point3f> &points, const std::vector<float> &errors);
+};
+
+#endif // MARKERSTAGE_H
@@ -0,0 +1,133 @@
+#include "metricswidget.h"
+#include "latencymetrics.h"
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QVBoxLayout>
+
+MetricsWidget::MetricsWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    table = new QTableWidget((int) Stage::Count, 6, this);
+    table->setHorizontalHeaderLabels(
+        {tr("Stage"), tr("Count"), tr("p50, ms"), tr("p95, ms"), tr("p99, ms"), tr("Max, ms")});
+    table->verticalHeader()->setVisible(false);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    for (int row = 0; row < table->rowCount(); row++) {
+        table->setItem(row, 0, new QTableWidgetItem(LatencyMetrics::stageName((Stage) row)));
+        for (int column = 1; column < table->columnCount(); column++) {
+            QTableWidgetItem *item = new QTableWidgetItem();
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            table->setItem(row, column, item);
+        }
+    }
+
+    cameraTable = new QTableWidget(0, 6, this);
+    cameraTable->setHorizontalHeaderLabels(
+        {tr("Camera"), tr("Frames"), tr("FPS"), tr("p50, ms"), tr("p95, ms"), tr("Max, ms")});
+    cameraTable->verticalHeader()->setVisible(false);
+    cameraTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    cameraTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    cameraTable->setSelectionMode(QAbstractItemView::NoSelection);
+
+    exportCsvButton = new QPushButton(tr("Export CSV..."), this);
+    connect(exportCsvButton, &QPushButton::clicked, this, &MetricsWidget::onExportCsvButton);
+    exportTraceButton = new QPushButton(tr("Export trace..."), this);
+    connect(exportTraceButton, &QPushButton::clicked, this, &MetricsWidget::onExportTraceButton);
+    resetButton = new QPushButton(tr("Reset"), this);
+    connect(resetButton, &QPushButton::clicked, this, &MetricsWidget::onResetButton);
+
+    QHBoxLayout *buttonsLayout = new QHBoxLayout();
+    buttonsLayout->addWidget(exportCsvButton);
+    buttonsLayout->addWidget(exportTraceButton);
+    buttonsLayout->addWidget(resetButton);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->addWidget(table);
+    mainLayout->addWidget(cameraTable);
+    mainLayout->addLayout(buttonsLayout);
+    setLayout(mainLayout);
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(500);
+    connect(refreshTimer, &QTimer::timeout, this, &MetricsWidget::refresh);
+}
+
+void MetricsWidget::showEvent(QShowEvent *event)
+{
+    refresh();
+    refreshTimer->start();
+    QWidget::showEvent(event);
+}
+
+// Nothing to compute while the panel is closed
+void MetricsWidget::hideEvent(QHideEvent *event)
+{
+    refreshTimer->stop();
+    QWidget::hideEvent(event);
+}
+
+void MetricsWidget::refresh()
+{
+    for (const StageSummary &summary : LatencyMetrics::instance().summary()) {
+        int row = (int) summary.stage;
+        table->item(row, 1)->setText(QString::number(summary.count));
+        table->item(row, 2)->setText(QString::number(summary.p50, 'f', 2));
+        table->item(row, 3)->setText(QString::number(summary.p95, 'f', 2));
+        table->item(row, 4)->setText(QString::number(summary.p99, 'f', 2));
+        table->item(row, 5)->setText(QString::number(summary.max, 'f', 2));
+    }
+
+    std::vector<CameraSummary> cameras = LatencyMetrics::instance().cameraSummary();
+    cameraTable->setRowCount((int) cameras.size());
+    for (int row = 0; row < (int) cameras.size(); row++) {
+        const CameraSummary &summary = cameras[row];
+        QStringList values = {
+            QString::number(summary.camera + 1),
+            QString::number(summary.frames),
+            QString::number(summary.fps, 'f', 1),
+            QString::number(summary.p50, 'f', 2),
+            QString::number(summary.p95, 'f', 2),
+            QString::number(summary.max, 'f', 2)};
+        for (int column = 0; column < values.size(); column++) {
+            QTableWidgetItem *item = cameraTable->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem();
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                cameraTable->setItem(row, column, item);
+            }
+            item->setText(values[column]);
+        }
+    }
+}
+
+void MetricsWidget::onExportCsvButton()
+{
+    QString fileName = QFileDialog::getSaveFileName(
+        this, tr("Export metrics"), "metrics.csv", tr("CSV files (*.csv)"));
+    if (fileName.isEmpty())
+        return;
+    if (!LatencyMetrics::instance().exportCsv(fileName)) {
+        QMessageBox::warning(this, tr("Error"), tr("Could not write file %1").arg(fileName));
+    }
+}
+
+void MetricsWidget::onExportTraceButton()
+{
+    QString fileName = QFileDialog::getSaveFileName(
+        this, tr("Export trace"), "trace.json", tr("Chrome trace files (*.json)"));
+    if (fileName.isEmpty())
+        return;
+    if (!LatencyMetrics::instance().exportChromeTrace(fileName)) {
+        QMessageBox::warning(this, tr("Error"), tr("Could not write file %1").arg(fileName));
+    }
+}
+
+void MetricsWidget::onResetButton()
+{
+    LatencyMetrics::instance().reset();
+    refresh();
+}
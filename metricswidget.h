@@ -0,0 +1,36 @@
+#ifndef METRICSWIDGET_H
+#define METRICSWIDGET_H
+
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+#include <QWidget>
+
+// Live tables of per-stage latency percentiles and per-camera throughput,
+// with trace export
+class MetricsWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit MetricsWidget(QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    QTableWidget *table;
+    QTableWidget *cameraTable;
+    QPushButton *exportCsvButton;
+    QPushButton *exportTraceButton;
+    QPushButton *resetButton;
+    QTimer *refreshTimer;
+
+private slots:
+    void refresh();
+    void onExportCsvButton();
+    void onExportTraceButton();
+    void onResetButton();
+};
+
+#endif // METRICSWIDGET_H
@@ -0,0 +1,272 @@
+#include "taskexecutor.h"
+#include <algorithm>
+#include <QDebug>
+#include <QThread>
+
+namespace {
+
+// Lets tasks submitted from inside the pool stay on the submitting worker
+thread_local const TaskExecutor *currentExecutor = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+bool TaskHandle::isRunning() const
+{
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+void TaskHandle::wait() const
+{
+    if (future.valid())
+        future.wait();
+}
+
+TaskExecutor &TaskExecutor::instance()
+{
+    static TaskExecutor executor;
+    return executor;
+}
+
+TaskExecutor::TaskExecutor(int threadCount)
+    : nextWorker(0)
+    , pending(0)
+    , shuttingDown(false)
+{
+    if (threadCount <= 0)
+        threadCount = qMax(2, QThread::idealThreadCount());
+    for (int i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->thread = std::thread([this, i]() { workerLoop(i); });
+    }
+}
+
+TaskExecutor::~TaskExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        shuttingDown = true;
+    }
+    wakeUp.notify_all();
+    for (auto &worker : workers) {
+        worker->thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(longRunningMutex);
+    for (LongRunningThread &longRunning : longRunningThreads) {
+        longRunning.thread.join();
+    }
+}
+
+TaskHandle TaskExecutor::submit(CancellableTask task, TaskPriority priority)
+{
+    TaskHandle handle;
+    post(wrap(std::move(task), handle.token, handle), priority);
+    return handle;
+}
+
+TaskHandle TaskExecutor::submitLongRunning(CancellableTask task)
+{
+    TaskHandle handle;
+    std::function<void()> body = wrap(std::move(task), handle.token, handle);
+
+    std::lock_guard<std::mutex> lock(longRunningMutex);
+    // Threads of loops that ended earlier are reaped here
+    for (auto it = longRunningThreads.begin(); it != longRunningThreads.end();) {
+        if (it->finished->load()) {
+            it->thread.join();
+            it = longRunningThreads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    auto finished = std::make_shared<std::atomic<bool>>(false);
+    std::thread thread([body, finished]() {
+        runTask(body);
+        finished->store(true);
+    });
+    longRunningThreads.push_back(LongRunningThread{std::move(thread), finished});
+    return handle;
+}
+
+void TaskExecutor::post(std::function<void()> task, TaskPriority priority)
+{
+    size_t index = currentExecutor == this
+                       ? currentWorker
+                       : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->queues[(int) priority].push_back(std::move(task));
+    }
+    pending.fetch_add(1);
+    {
+        // Taking the lock orders the notify after a sleeper's last check
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+void TaskExecutor::parallelFor(int count, const std::function<void(int)> &body)
+{
+    if (count <= 0)
+        return;
+
+    struct State
+    {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+
+    // Helpers that start after every index is taken return without touching body
+    auto run = [state, count, &body]() {
+        for (;;) {
+            int i = state->next.fetch_add(1);
+            if (i >= count)
+                return;
+            body(i);
+            if (state->done.fetch_add(1) + 1 == count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    int helpers = std::min(count, threadCount()) - 1;
+    for (int i = 0; i < helpers; i++) {
+        post(run, TaskPriority::High);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state, count]() { return state->done.load() == count; });
+}
+
+void TaskExecutor::workerLoop(size_t index)
+{
+    currentExecutor = this;
+    currentWorker = index;
+
+    std::function<void()> task;
+    for (;;) {
+        if (takeTask(index, task)) {
+            runTask(task);
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]() { return pending.load() > 0 || shuttingDown; });
+        if (shuttingDown)
+            return;
+    }
+}
+
+bool TaskExecutor::takeTask(size_t index, std::function<void()> &task)
+{
+    for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+        // Own work first, newest on top while it is still warm in the cache
+        {
+            Worker &own = *workers[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.queues[priority].empty()) {
+                task = std::move(own.queues[priority].back());
+                own.queues[priority].pop_back();
+                pending.fetch_sub(1);
+                return true;
+            }
+        }
+
+        for (size_t offset = 1; offset < workers.size(); offset++) {
+            Worker &victim = *workers[(index + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.queues[priority].empty()) {
+                task = std::move(victim.queues[priority].front());
+                victim.queues[priority].pop_front();
+                pending.fetch_sub(1);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TaskExecutor::runTask(const std::function<void()> &task)
+{
+    try {
+        task();
+    } catch (const std::exception &e) {
+        qWarning() << "Task failed:" << e.what();
+    } catch (...) {
+        qWarning() << "Task failed with an unknown exception";
+    }
+}
+
+std::function<void()> TaskExecutor::wrap(
+    CancellableTask task, const CancellationToken &token, TaskHandle &handle)
+{
+    auto promise = std::make_shared<std::promise<void>>();
+    handle.future = promise->get_future().share();
+    return [task, token, promise]() {
+        try {
+            if (!token.isCancelled())
+                task(token);
+            promise->set_value();
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    };
+}
+
+SerialQueue::SerialQueue(TaskExecutor &executor, TaskPriority priority)
+    : executor(executor)
+    , priority(priority)
+    , scheduled(false)
+{}
+
+SerialQueue::~SerialQueue()
+{
+    waitForIdle();
+}
+
+void SerialQueue::post(std::function<void()> task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+    if (!scheduled) {
+        scheduled = true;
+        executor.post([this]() { runNext(); }, priority);
+    }
+}
+
+void SerialQueue::waitForIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return !scheduled; });
+}
+
+void SerialQueue::runNext()
+{
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = std::move(tasks.front());
+        tasks.pop_front();
+    }
+
+    TaskExecutor::runTask(task);
+
+    // One task per pool slot keeps a long queue from hogging a worker
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty()) {
+        scheduled = false;
+        idle.notify_all();
+    } else {
+        executor.post([this]() { runNext(); }, priority);
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef TASKEXECUTOR_H
+#define TASKEXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class TaskPriority { High, Normal, Low };
+
+// Cooperative cancellation, copies share the same flag
+class CancellationToken
+{
+public:
+    CancellationToken()
+        : flag(std::make_shared<std::atomic<bool>>(false))
+    {}
+
+    bool isCancelled() const { return flag->load(std::memory_order_relaxed); }
+    void cancel() { flag->store(true, std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+// A submitted task. Cancelling one that has not started yet skips it.
+class TaskHandle
+{
+public:
+    bool isRunning() const;
+    void cancel() { token.cancel(); }
+    void wait() const;
+
+private:
+    friend class TaskExecutor;
+
+    std::shared_future<void> future;
+    CancellationToken token;
+};
+
+using CancellableTask = std::function<void(const CancellationToken &)>;
+
+// Process wide work-stealing pool with one worker per core. Every worker owns
+// a deque per priority, it takes its own newest task first and steals the
+// oldest ones from the others when it runs dry. Higher priorities are always
+// drained first, pool wide.
+class TaskExecutor
+{
+public:
+    static TaskExecutor &instance();
+
+    explicit TaskExecutor(int threadCount = 0);
+    ~TaskExecutor();
+
+    TaskExecutor(const TaskExecutor &) = delete;
+    TaskExecutor &operator=(const TaskExecutor &) = delete;
+
+    TaskHandle submit(CancellableTask task, TaskPriority priority = TaskPriority::Normal);
+    // For loops that block for their whole life, like capture. They get a
+    // thread of their own so they never take a worker away from the pool.
+    TaskHandle submitLongRunning(CancellableTask task);
+    void post(std::function<void()> task, TaskPriority priority = TaskPriority::Normal);
+
+    // Runs body(0) .. body(count - 1) on the pool and returns when all are
+    // done. The calling thread takes part, so it is safe to nest.
+    void parallelFor(int count, const std::function<void(int)> &body);
+
+    int threadCount() const { return (int) workers.size(); }
+
+private:
+    // Shares the exception guard of pool tasks
+    friend class SerialQueue;
+
+    static constexpr int PRIORITY_COUNT = 3;
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> queues[PRIORITY_COUNT];
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<size_t> nextWorker;
+    std::atomic<int> pending;
+    std::atomic<bool> shuttingDown;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+
+    struct LongRunningThread
+    {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+
+    std::mutex longRunningMutex;
+    std::vector<LongRunningThread> longRunningThreads;
+
+    void workerLoop(size_t index);
+    bool takeTask(size_t index, std::function<void()> &task);
+    static void runTask(const std::function<void()> &task);
+    static std::function<void()> wrap(
+        CancellableTask task, const CancellationToken &token, TaskHandle &handle);
+};
+
+// Runs tasks one at a time in the order they were posted, on the shared pool
+class SerialQueue
+{
+public:
+    explicit SerialQueue(TaskExecutor &executor, TaskPriority priority = TaskPriority::Normal);
+    ~SerialQueue();
+
+    void post(std::function<void()> task);
+    void waitForIdle();
+
+private:
+    TaskExecutor &executor;
+    TaskPriority priority;
+
+    std::mutex mutex;
+    std::condition_variable idle;
+    std::deque<std::function<void()>> tasks;
+    bool scheduled;
+
+    void runNext();
+};
+
+#endif // TASKEXECUTOR_H
@@ -0,0 +1,25 @@
+#include "trackingstream.h"
+
+TrackingStream::TrackingStream()
+    : merged(std::make_shared<const MergedTrackingResult>())
+{}
+
+void TrackingStream::publish(std::shared_ptr<const MarkerFrameResult> result)
+{
+    if (result->camera < 0)
+        return;
+
+    QMutexLocker locker(&mutex);
+    std::shared_ptr<const MergedTrackingResult> previous = std::atomic_load(&merged);
+    auto next = std::make_shared<MergedTrackingResult>(*previous);
+    next->sequence = previous->sequence + 1;
+    if (result->camera >= (int) next->cameras.size())
+        next->cameras.resize(result->camera + 1);
+    next->cameras[result->camera] = std::move(result);
+    std::atomic_store(&merged, std::shared_ptr<const MergedTrackingResult>(std::move(next)));
+}
+
+std::shared_ptr<const MergedTrackingResult> TrackingStream::latest() const
+{
+    return std::atomic_load(&merged);
+}
@@ -0,0 +1,34 @@
+#ifndef TRACKINGSTREAM_H
+#define TRACKINGSTREAM_H
+
+#include "markerstage.h"
+#include <memory>
+#include <QMutex>
+#include <vector>
+
+// Latest tracking result of every camera at one point in time
+struct MergedTrackingResult
+{
+    quint64 sequence = 0;
+    // Indexed by camera, null until that camera publishes
+    std::vector<std::shared_ptr<const MarkerFrameResult>> cameras;
+};
+
+// Merges the results the camera pipelines publish from their capture
+// threads into one stream. Every publish makes a new snapshot, readers on
+// any thread get a consistent view of all cameras without locking.
+class TrackingStream
+{
+public:
+    TrackingStream();
+
+    void publish(std::shared_ptr<const MarkerFrameResult> result);
+    std::shared_ptr<const MergedTrackingResult> latest() const;
+
+private:
+    // Serializes publishers, readers only load the pointer
+    QMutex mutex;
+    std::shared_ptr<const MergedTrackingResult> merged;
+};
+
+#endif // TRACKINGSTREAM_H
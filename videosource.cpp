@@ -0,0 +1,203 @@
+#include "videosource.h"
+#include "latencymetrics.h"
+#include <QDebug>
+
+VideoSource::VideoSource(int deviceIndex, const cv::Size &processingSize, double fps)
+    : deviceIndex(deviceIndex)
+    , processingSize(processingSize)
+    , requestedFps(fps)
+    , rawFrames(false)
+    , currentState(CaptureState::Stopped)
+    , paused(false)
+    , stopped(false)
+    , backoffMs(INITIAL_BACKOFF_MS)
+    , failedReads(0)
+    , stallStart(0)
+{}
+
+void VideoSource::start()
+{
+    bool opened = openDevice();
+    QMutexLocker locker(&mutex);
+    if (opened) {
+        currentState = CaptureState::Streaming;
+    } else {
+        qWarning() << "Failed to open video feed, retrying";
+        enterStalled();
+    }
+}
+
+void VideoSource::close()
+{
+    cap.release();
+    QMutexLocker locker(&mutex);
+    currentState = CaptureState::Stopped;
+    // Ready for the next start()
+    stopped = false;
+}
+
+bool VideoSource::read(CameraFrame &frame)
+{
+    for (;;) {
+        {
+            QMutexLocker locker(&mutex);
+            while (paused && !stopped) {
+                currentState = CaptureState::Paused;
+                wakeUp.wait(&mutex);
+            }
+            if (stopped)
+                return false;
+            if (currentState == CaptureState::Paused)
+                currentState = CaptureState::Streaming;
+        }
+
+        // A new Mat every time, the backend would otherwise reuse the buffer
+        cv::Mat raw;
+        if (cap.isOpened()) {
+            ScopedStageTimer timer(Stage::CaptureWait);
+            cap >> raw;
+        }
+        if (raw.empty()) {
+            frame = CameraFrame();
+        } else {
+            ScopedStageTimer timer(Stage::Resize);
+            frame = CameraFrame(raw, frameSize, processingSize);
+            timer.stop();
+            // Cheap enough to measure every frame, the stages decide what to skip
+            ScopedStageTimer sharpnessTimer(Stage::Sharpness);
+            frame.measureSharpness();
+        }
+        if (!raw.empty() && frame.empty() && rawFrames) {
+            qWarning() << "Unknown raw frame layout, falling back to BGR capture";
+            rawFrames = false;
+            cap.set(cv::CAP_PROP_CONVERT_RGB, 1);
+            updateMode();
+            continue;
+        }
+        if (!frame.empty()) {
+            frameArrived();
+            return true;
+        }
+        backOff();
+    }
+}
+
+void VideoSource::setPaused(bool isPaused)
+{
+    QMutexLocker locker(&mutex);
+    paused = isPaused;
+    wakeUp.wakeAll();
+}
+
+void VideoSource::stop()
+{
+    QMutexLocker locker(&mutex);
+    stopped = true;
+    wakeUp.wakeAll();
+}
+
+CaptureState VideoSource::state() const
+{
+    QMutexLocker locker(&mutex);
+    return currentState;
+}
+
+CaptureMode VideoSource::mode() const
+{
+    QMutexLocker locker(&mutex);
+    return currentMode;
+}
+
+bool VideoSource::openDevice()
+{
+    cap.release();
+    cap.open(deviceIndex); // for webcam
+    // cap.open(
+    //     "udpsrc port=5000 caps = \"application/x-rtp, media=(string)video, clock-rate=(int)90000, "
+    //     "encoding-name=(string)H264, payload=(int)96\" ! rtph264depay ! decodebin ! videoconvert ! "
+    //     "appsink",
+    //     cv::CAP_GSTREAMER);
+    if (!cap.isOpened())
+        return false;
+
+    // Requests the device ignores leave it in its own mode, frames are then
+    // scaled to the processing size. Backends that cannot deliver YUYV keep
+    // converting to BGR.
+    cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V'));
+    cap.set(cv::CAP_PROP_FRAME_WIDTH, processingSize.width);
+    cap.set(cv::CAP_PROP_FRAME_HEIGHT, processingSize.height);
+    cap.set(cv::CAP_PROP_FPS, requestedFps);
+    rawFrames = cap.set(cv::CAP_PROP_CONVERT_RGB, 0);
+    updateMode();
+    return true;
+}
+
+void VideoSource::updateMode()
+{
+    frameSize = cv::Size(
+        (int) cap.get(cv::CAP_PROP_FRAME_WIDTH), (int) cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+
+    CaptureMode mode;
+    mode.deviceSize = frameSize;
+    mode.fps = cap.get(cv::CAP_PROP_FPS);
+    mode.processingSize = processingSize;
+    mode.pixelFormat = "BGR";
+    int fourcc = (int) cap.get(cv::CAP_PROP_FOURCC);
+    if (rawFrames && fourcc != 0) {
+        mode.pixelFormat.clear();
+        for (int i = 0; i < 4; i++) {
+            mode.pixelFormat += (char) ((fourcc >> (8 * i)) & 0xff);
+        }
+    }
+    qInfo().noquote() << QString("Camera %1: %2x%3 %4 at %5 fps, processed at %6x%7")
+                             .arg(deviceIndex)
+                             .arg(mode.deviceSize.width)
+                             .arg(mode.deviceSize.height)
+                             .arg(QString::fromStdString(mode.pixelFormat))
+                             .arg(mode.fps)
+                             .arg(processingSize.width)
+                             .arg(processingSize.height);
+
+    QMutexLocker locker(&mutex);
+    currentMode = mode;
+}
+
+void VideoSource::enterStalled()
+{
+    if (currentState == CaptureState::Stalled)
+        return;
+    currentState = CaptureState::Stalled;
+    stallStart = LatencyMetrics::now();
+    backoffMs = INITIAL_BACKOFF_MS;
+    failedReads = 0;
+}
+
+void VideoSource::backOff()
+{
+    bool reopen = false;
+    {
+        QMutexLocker locker(&mutex);
+        if (currentState != CaptureState::Stalled)
+            qWarning() << "Video feed stalled, backing off";
+        enterStalled();
+        failedReads++;
+        // Sleeping on the condition lets stop() and setPaused() cut it short
+        if (!stopped && !paused)
+            wakeUp.wait(&mutex, backoffMs);
+        backoffMs = qMin(backoffMs * 2, MAX_BACKOFF_MS);
+        reopen = !stopped && !paused && (!cap.isOpened() || failedReads % REOPEN_AFTER == 0);
+    }
+    if (reopen)
+        openDevice();
+}
+
+void VideoSource::frameArrived()
+{
+    QMutexLocker locker(&mutex);
+    if (currentState == CaptureState::Stalled) {
+        qint64 now = LatencyMetrics::now();
+        LatencyMetrics::instance().record(Stage::Reconnect, stallStart, now);
+        qInfo() << "Video feed recovered after" << (now - stallStart) / 1000000 << "ms";
+    }
+    currentState = CaptureState::Streaming;
+}
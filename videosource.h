@@ -0,0 +1,80 @@
+#ifndef VIDEOSOURCE_H
+#define VIDEOSOURCE_H
+
+#include "cameraframe.h"
+#include <opencv2/opencv.hpp>
+#include <QMutex>
+#include <QWaitCondition>
+
+enum class CaptureState { Stopped, Streaming, Stalled, Paused };
+
+// What the device delivers after negotiation, and the size frames are
+// processed at. Frames are only scaled when the two sizes differ.
+struct CaptureMode
+{
+    cv::Size deviceSize;
+    double fps = 0.0;
+    // "BGR" when the backend converts the frames
+    std::string pixelFormat;
+    cv::Size processingSize;
+};
+
+// Camera device driven by a small state machine. Empty reads move it to
+// Stalled, where it backs off exponentially and reopens the device now and
+// then. Stalled and paused sources sleep on a wait condition instead of
+// polling, stop() and setPaused() wake them at once. The device is asked for
+// YUYV without conversion to BGR at the processing size and frame rate, so
+// detection can use its luma plane as is.
+class VideoSource
+{
+public:
+    VideoSource(int deviceIndex, const cv::Size &processingSize, double fps);
+
+    // Called by the capturing thread around its read loop
+    void start();
+    void close();
+    // Blocks until the next frame is available, false once stopped. Every
+    // frame gets a buffer of its own, stages may keep it.
+    bool read(CameraFrame &frame);
+
+    // Safe to call from any thread
+    void setPaused(bool paused);
+    void stop();
+    CaptureState state() const;
+    // Empty device size until the device has been opened
+    CaptureMode mode() const;
+
+private:
+    static constexpr int INITIAL_BACKOFF_MS = 10;
+    static constexpr int MAX_BACKOFF_MS = 2000;
+    // Empty reads in a row before the device is reopened
+    static constexpr int REOPEN_AFTER = 3;
+
+    int deviceIndex;
+    cv::Size processingSize;
+    double requestedFps;
+    // Only touched by the capturing thread
+    cv::VideoCapture cap;
+    cv::Size frameSize;
+    // Raw YUYV was requested, cleared if the backend delivers an unknown layout
+    bool rawFrames;
+
+    mutable QMutex mutex;
+    QWaitCondition wakeUp;
+    CaptureState currentState;
+    CaptureMode currentMode;
+    bool paused;
+    bool stopped;
+    int backoffMs;
+    int failedReads;
+    qint64 stallStart;
+
+    bool openDevice();
+    // Reads back what the device agreed to
+    void updateMode();
+    void enterStalled();
+    void backOff();
+    void frameArrived();
+};
+
+#endif // VIDEOSOURCE_H
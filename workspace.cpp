@@ -1,82 +1,226 @@
 #include "workspace.h"
+#include "latencymetrics.h"
 #include <QDebug>
+#include <QFile>
 #include <QFileDialog>
 
 Workspace::Workspace(QObject *parent)
     : QObject{parent}
     , yamlHandler(new YamlHandler(this))
-    , cameraThread(new CameraThread())
-    , calibrationThread(new CalibrationThread())
-    , markerThread(new MarkerThread())
+    , activeCamera(0)
+    , trackingPage(false)
+    , calibrationTask(new CalibrationTask(this))
+    , configurationRepository(new ConfigurationRepository(yamlHandler, &ioWorker, this))
+    , compactor(new ConfigurationCompactor(this))
+    , compactionTimer(new QTimer(this))
     , frameNumber(0)
+    , pendingClears(0)
     , imagesDir(QDir::currentPath() + "/images")
-    , calibrationStatus(false)
-    , calibrationParams{}
 {
-    connect(cameraThread, &CameraThread::frameReady, this, &Workspace::frameReady);
-    connect(markerThread, &MarkerThread::frameReady, this, &Workspace::frameReady);
-    connect(this, &Workspace::pointSelected, markerThread, &MarkerThread::onPointSelected);
-    connect(markerThread, &MarkerThread::newConfiguration, this, &Workspace::newConfiguration);
+    createCameras();
+    connect(this, &Workspace::pointSelected, this, [this](const QPointF &point) {
+        activePipeline().markerStage().onPointSelected(point);
+    });
     connect(
+        configurationRepository,
+        &ConfigurationRepository::snapshotChanged,
         this,
-        &Workspace::configurationsUpdated,
-        markerThread,
-        &MarkerThread::updateConfigurationsMap);
-    connect(calibrationThread, &CalibrationThread::taskFinished, this, &Workspace::taskFinished);
+        &Workspace::onConfigurationsChanged);
+    connect(calibrationTask, &CalibrationTask::taskFinished, this, &Workspace::taskFinished);
     connect(yamlHandler, &YamlHandler::taskFinished, this, &Workspace::taskFinished);
+
+    // Edits are appended to a journal, fold it into a snapshot now and then
+    compactor->setFileName(QString::fromStdString(CONFIGURATIONS_FILE));
+    compactionTimer->setInterval(5 * 60 * 1000);
+    connect(compactionTimer, &QTimer::timeout, compactor, &ConfigurationCompactor::compactIfNeeded);
 }
 
 Workspace::~Workspace()
 {
-    stopThread(cameraThread);
-    stopThread(calibrationThread);
-    stopThread(markerThread);
+    for (auto &camera : cameras) {
+        camera->capture().stop();
+    }
+    for (auto &camera : cameras) {
+        camera->capture().wait();
+    }
+    calibrationTask->cancel();
+    calibrationTask->wait();
+    compactionTimer->stop();
+    compactor->wait();
+    // Pending writes still reach the disk
+    ioWorker.waitForIdle();
 }
 
 void Workspace::init()
 {
-    // Load calibration params
-    calibrationFileName = "calibration.yml";
     ensureDirectoryIsClean(imagesDir);
-    calibrationStatus
-        = yamlHandler->loadCalibrationParameters(calibrationFileName, calibrationParams);
-    emit calibrationUpdated(calibrationStatus);
 
-    // Initialize threads
-    calibrationThread->setYamlHandler(yamlHandler);
-    markerThread->setYamlHandler(yamlHandler);
-    if (calibrationStatus) {
-        markerThread->setCalibrationParams(calibrationParams);
+    // Load calibration params, every camera has its own file
+    for (auto &camera : cameras) {
+        int index = camera->index();
+        std::string calibrationFile = camera->calibrationFile();
+        ioWorker.post(
+            this,
+            [this, calibrationFile]() {
+                CalibrationParams params;
+                bool loaded = yamlHandler->loadCalibrationParameters(calibrationFile, params);
+                return std::make_pair(loaded, params);
+            },
+            [this, index, calibrationFile](const std::pair<bool, CalibrationParams> &result) {
+                applyCalibrationParams(index, result.first, result.second, calibrationFile);
+            });
+    }
+
+    ioWorker.post([this]() {
+        // Libraries from before the binary store are migrated once
+        if (!QFile::exists(QString::fromStdString(CONFIGURATIONS_FILE))
+            && QFile::exists(QString::fromStdString(LEGACY_CONFIGURATIONS_FILE))) {
+            std::map<std::string, Configuration> legacyConfigurations;
+            if (yamlHandler->loadConfigurations(LEGACY_CONFIGURATIONS_FILE, legacyConfigurations))
+                yamlHandler->saveConfigurations(CONFIGURATIONS_FILE, legacyConfigurations);
+        }
+    });
+    // Its first read is queued behind the migration
+    configurationRepository->open(CONFIGURATIONS_FILE);
+    compactionTimer->start();
+
+    calibrationTask->setYamlHandler(yamlHandler);
+
+    // Station specific detector profile, defaults are used when it is missing
+    ioWorker.post(
+        this,
+        [this]() {
+            DetectorSettings settings;
+            yamlHandler->loadDetectorSettings("detector.yml", settings);
+            return settings;
+        },
+        [this](const DetectorSettings &settings) {
+            setDetectorSettings(settings);
+            emit detectorSettingsUpdated(detectorSettings);
+        });
+
+    updateStages();
+    for (auto &camera : cameras) {
+        camera->capture().start();
+    }
+}
+
+void Workspace::createCameras()
+{
+    // Read before anything starts, the whole workspace is shaped by it
+    std::vector<CameraSettings> settings;
+    if (!yamlHandler->loadCameraSettings(CAMERAS_FILE, settings))
+        settings.assign(1, CameraSettings());
+    if ((int) settings.size() > LatencyMetrics::MAX_CAMERAS)
+        qWarning() << "Metrics are only reported for the first" << LatencyMetrics::MAX_CAMERAS
+                   << "cameras";
+
+    for (size_t i = 0; i < settings.size(); i++) {
+        cameras.push_back(std::make_unique<CameraPipeline>((int) i, settings[i], &trackingStream));
+        // Only the camera in the view prepares display frames, the view
+        // hands that over on a switch. All of them keep publishing results.
+        cameras.back()->frameMailbox()->setActive((int) i == activeCamera);
+        MarkerStage *stage = &cameras.back()->markerStage();
+        int index = (int) i;
+        // The UI follows the active camera only
+        connect(stage, &MarkerStage::newConfiguration, this, [this, index](const Configuration &c) {
+            if (index == activeCamera)
+                emit newConfiguration(c);
+        });
+        connect(stage, &MarkerStage::detectionStats, this, [this, index](double ms, int markers) {
+            if (index == activeCamera)
+                emit detectionStats(ms, markers);
+        });
+        connect(stage, &MarkerStage::sharpnessStats, this, [this, index](double value, int skips) {
+            if (index == activeCamera)
+                emit sharpnessStats(value, skips);
+        });
     }
+}
 
-    startThread(cameraThread);
+void Workspace::updateStages()
+{
+    for (auto &camera : cameras) {
+        FrameStage *stage = nullptr;
+        if (trackingPage) {
+            // Every calibrated camera tracks, the others stay paused
+            if (camera->isCalibrated())
+                stage = &camera->markerStage();
+        } else if (camera->index() == activeCamera) {
+            // Calibration capture only needs the camera being calibrated
+            stage = &camera->cameraStage();
+        }
+        camera->capture().setStage(stage);
+    }
 }
 
-std::map<std::string, Configuration> Workspace::getConfigurations()
+void Workspace::setActiveCamera(int camera)
 {
-    std::map<std::string, Configuration> configurations;
-    yamlHandler->loadConfigurations("configurations.yml", configurations);
-    return configurations;
+    if (camera < 0 || camera >= cameraCount() || camera == activeCamera)
+        return;
+    activeCamera = camera;
+
+    // Captured images belong to the camera they were taken with. A run stops
+    // at its next step and may read them until then, so they are removed on
+    // the I/O queue once it has. Capture and calibration wait for that.
+    calibrationTask->cancel();
+    if (pendingClears++ == 0)
+        emit imagesBusy(true);
+    ioWorker.post(
+        this,
+        [this]() {
+            calibrationTask->wait();
+            clearDirectory(imagesDir);
+            return true;
+        },
+        [this](bool) {
+            if (--pendingClears == 0)
+                emit imagesBusy(false);
+        });
+    frameNumber = 0;
+    emit frameCaptured(frameNumber);
+
+    updateStages();
+    emit activeCameraChanged(activeCamera);
+    emit calibrationUpdated(activePipeline().isCalibrated());
+}
+
+void Workspace::onConfigurationsChanged()
+{
+    ConfigurationSnapshotPtr snapshot = configurationRepository->snapshot();
+    for (auto &camera : cameras) {
+        camera->markerStage().setConfigurations(snapshot);
+    }
+    emit configurationsUpdated();
+    compactor->compactIfNeeded();
 }
 
 void Workspace::onCaptureFrame()
 {
-    if (cameraThread->saveCurrentFrame(imagesDir, frameNumber++)) {
+    if (pendingClears > 0)
+        return;
+    QString error;
+    if (activePipeline().cameraStage().saveCurrentFrame(imagesDir, frameNumber++, error)) {
         emit frameCaptured(frameNumber);
     } else {
         frameNumber--;
-        emit taskFinished(false, tr("Could not save frame"));
+        emit taskFinished(false, error);
     }
 }
 
 void Workspace::onStartCalibration()
 {
-    startThread(calibrationThread);
+    if (pendingClears > 0)
+        return;
+    calibrationTask->setOutputFile(activePipeline().calibrationFile());
+    calibrationTask->start();
 }
 
 void Workspace::onMarkerSizeChanged(int size)
 {
-    markerThread->setMarkerSize(size);
+    for (auto &camera : cameras) {
+        camera->markerStage().setMarkerSize(size);
+    }
 }
 
 void Workspace::saveConfiguration(const Configuration &newConfiguration)
@@ -86,8 +230,9 @@ void Workspace::saveConfiguration(const Configuration &newConfiguration)
         emit taskFinished(false, tr("Block is not detected"));
         return;
     }
-    yamlHandler->updateConfigurations("configurations.yml", currentConfiguration);
-    emit configurationsUpdated();
+    ioWorker.post([this, currentConfiguration]() {
+        configurationRepository->saveConfiguration(currentConfiguration);
+    });
     return;
 }
 
@@ -99,88 +244,135 @@ void Workspace::saveSingleConfiguration(
         emit taskFinished(false, tr("Block is not detected"));
         return;
     }
-    std::map<std::string, Configuration> configurations;
-    configurations.insert(std::make_pair(currentConfiguration.name, currentConfiguration));
-    if (yamlHandler->saveConfigurations(fileName.toStdString(), configurations)) {
-        emit taskFinished(true, tr("Block is saved to file %1").arg(fileName));
-    } else {
-        emit taskFinished(false, tr("Error occured while saving block"));
-    }
+    ioWorker.post(
+        this,
+        [this, currentConfiguration, fileName]() {
+            std::map<std::string, Configuration> singleConfiguration;
+            singleConfiguration.insert(
+                std::make_pair(currentConfiguration.name, currentConfiguration));
+            return yamlHandler->saveConfigurations(fileName.toStdString(), singleConfiguration);
+        },
+        [this, fileName](bool saved) {
+            if (saved) {
+                emit taskFinished(true, tr("Block is saved to file %1").arg(fileName));
+            } else {
+                emit taskFinished(false, tr("Error occured while saving block"));
+            }
+        });
     return;
 }
 
 void Workspace::editConfiguration(const Configuration &newConfiguration)
 {
-    yamlHandler->updateConfigurations("configurations.yml", newConfiguration);
-    emit configurationsUpdated();
+    ioWorker.post([this, newConfiguration]() {
+        configurationRepository->saveConfiguration(newConfiguration);
+    });
 }
 
 void Workspace::removeConfiguration(const Configuration &config)
 {
-    yamlHandler->removeConfiguration("configurations.yml", config);
-    emit configurationsUpdated();
+    ioWorker.post([this, config]() { configurationRepository->removeConfiguration(config); });
 }
 
 void Workspace::exportConfiguration(const QString &fileName)
 {
-    std::map<std::string, Configuration> configurations;
-    yamlHandler->loadConfigurations(fileName.toStdString(), configurations);
-    for (const auto &config : configurations) {
-        yamlHandler->updateConfigurations("configurations.yml", config.second);
-    }
-    emit configurationsUpdated();
+    ioWorker.post(
+        this,
+        [this, fileName]() {
+            std::map<std::string, Configuration> importedConfigurations;
+            if (!yamlHandler->loadConfigurations(fileName.toStdString(), importedConfigurations))
+                return false;
+            ImportReport report;
+            configurationRepository->importConfigurations(importedConfigurations, report);
+            return true;
+        },
+        [this, fileName](bool read) {
+            if (!read)
+                emit taskFinished(false, tr("Could not read file %1").arg(fileName));
+        });
 }
 
 void Workspace::selectCalibrationFile(const QString &fileName)
 {
-    calibrationStatus
-        = yamlHandler->loadCalibrationParameters(fileName.toStdString(), calibrationParams);
-    if (calibrationStatus) {
-        emit calibrationUpdated(true);
-        calibrationFileName = fileName.toStdString();
-        markerThread->setCalibrationParams(calibrationParams);
+    int camera = activeCamera;
+    ioWorker.post(
+        this,
+        [this, fileName]() {
+            CalibrationParams params;
+            bool loaded = yamlHandler->loadCalibrationParameters(fileName.toStdString(), params);
+            return std::make_pair(loaded, params);
+        },
+        [this, camera, fileName](const std::pair<bool, CalibrationParams> &result) {
+            applyCalibrationParams(camera, result.first, result.second, fileName.toStdString());
+            if (!result.first) {
+                emit taskFinished(
+                    false,
+                    QString(tr("Could not load calibration params from file %1").arg(fileName)));
+            }
+        });
+}
+
+void Workspace::applyCalibrationParams(
+    int camera, bool loaded, const CalibrationParams &params, const std::string &fileName)
+{
+    CameraPipeline &pipeline = *cameras[camera];
+    if (loaded) {
+        pipeline.applyCalibration(params, fileName);
     } else {
-        emit calibrationUpdated(false);
-        emit taskFinished(
-            false, QString(tr("Could not load calibration params from file %1").arg(fileName)));
+        pipeline.invalidateCalibration();
     }
+    if (camera == activeCamera)
+        emit calibrationUpdated(loaded);
+    // A camera that got its calibration while tracking joins in
+    updateStages();
 }
 
-void Workspace::startThread(QThread *thread)
+void Workspace::setDetectorSettings(const DetectorSettings &settings)
 {
-    if (thread && !thread->isRunning()) {
-        thread->start();
+    detectorSettings = settings;
+    for (auto &camera : cameras) {
+        camera->markerStage().setDetectorSettings(detectorSettings);
+        camera->cameraStage().setMinSharpness(detectorSettings.minSharpness);
     }
+    calibrationTask->setDetectorSettings(detectorSettings);
 }
 
-void Workspace::stopThread(QThread *thread)
+void Workspace::loadDetectorProfile(const QString &fileName)
 {
-    if (thread && thread->isRunning()) {
-        CameraThread *camera = dynamic_cast<CameraThread *>(thread);
-        if (camera) {
-            camera->stop();
-            camera->wait();
-            return;
-        }
-
-        CalibrationThread *calibration = dynamic_cast<CalibrationThread *>(thread);
-        if (calibration) {
-            calibration->stop();
-            calibration->wait();
-            return;
-        }
-
-        MarkerThread *marker = dynamic_cast<MarkerThread *>(thread);
-        if (marker) {
-            marker->stop();
-            marker->wait();
-            return;
-        }
+    ioWorker.post(
+        this,
+        [this, fileName]() {
+            DetectorSettings settings;
+            bool loaded = yamlHandler->loadDetectorSettings(fileName.toStdString(), settings);
+            return std::make_pair(loaded, settings);
+        },
+        [this, fileName](const std::pair<bool, DetectorSettings> &result) {
+            if (result.first) {
+                setDetectorSettings(result.second);
+                emit detectorSettingsUpdated(detectorSettings);
+            } else {
+                emit taskFinished(
+                    false,
+                    QString(tr("Could not load detector profile from file %1").arg(fileName)));
+            }
+        });
+}
 
-        // default
-        thread->quit();
-        thread->wait();
-    }
+void Workspace::saveDetectorProfile(const QString &fileName)
+{
+    DetectorSettings settings = detectorSettings;
+    ioWorker.post(
+        this,
+        [this, fileName, settings]() {
+            return yamlHandler->saveDetectorSettings(fileName.toStdString(), settings);
+        },
+        [this, fileName](bool saved) {
+            if (saved) {
+                emit taskFinished(true, tr("Detector profile is saved to file %1").arg(fileName));
+            } else {
+                emit taskFinished(false, tr("Error occured while saving detector profile"));
+            }
+        });
 }
 
 void Workspace::ensureDirectoryIsClean(const QString &path)
@@ -196,12 +388,11 @@ void Workspace::ensureDirectoryIsClean(const QString &path)
 void Workspace::onPageChanged(int page)
 {
     if (page == 0) {
-        // Simply switch to camera thread
-        stopThread(markerThread);
-        startThread(cameraThread);
+        // Simply switch to the raw camera feed
+        trackingPage = false;
     } else {
-        // Before going to marker thread, check if calibration parameters are loaded
-        if (!calibrationStatus) {
+        // Before tracking markers, check if calibration parameters are loaded
+        if (!activePipeline().isCalibrated()) {
             emit calibrationParamsMissing();
             emit taskFinished(
                 false,
@@ -209,14 +400,14 @@ void Workspace::onPageChanged(int page)
             return;
         }
 
-        // Switch threads
-        stopThread(cameraThread);
-        stopThread(calibrationThread);
-        startThread(markerThread);
+        calibrationTask->cancel();
+        trackingPage = true;
     }
+    // Switch stages
+    updateStages();
 }
 
-// Clears the directory with calibration images directory on app startup
+// Clears the calibration images directory on app startup and camera switch
 void Workspace::clearDirectory(const QString &path)
 {
     QDir dir(path);
@@ -229,7 +420,17 @@ void Workspace::clearDirectory(const QString &path)
 
 Configuration Workspace::getCurrentConfiguration(const Configuration &newConfiguration)
 {
-    Configuration currentConfiguration = markerThread->getCurrConfiguration();
+    // The active camera first, any other camera that sees a block otherwise.
+    // Relative points do not depend on the camera they were measured with.
+    Configuration currentConfiguration = activePipeline().markerStage().getCurrConfiguration();
+    if (currentConfiguration.markerIds.empty()) {
+        for (const auto &result : trackingStream.latest()->cameras) {
+            if (result && !result->currentConfiguration.markerIds.empty()) {
+                currentConfiguration = result->currentConfiguration;
+                break;
+            }
+        }
+    }
     currentConfiguration.id = newConfiguration.id;
     currentConfiguration.type = newConfiguration.type;
     currentConfiguration.name = newConfiguration.name;
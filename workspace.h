@@ -1,13 +1,18 @@
 #ifndef WORKSPACE_H
 #define WORKSPACE_H
 
-#include "calibrationthread.h"
-#include "markerthread.h"
+#include "calibrationtask.h"
+#include "camerapipeline.h"
+#include "configurationcompactor.h"
+#include "configurationrepository.h"
+#include "ioworker.h"
+#include "trackingstream.h"
 #include "yamlhandler.h"
-#include <camerathread.h>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <QDir>
 #include <QObject>
+#include <QTimer>
 
 class Workspace : public QObject
 {
@@ -17,10 +22,19 @@ public:
     ~Workspace();
 
     void init();
-    std::map<std::string, Configuration> getConfigurations();
+    ConfigurationSnapshotPtr getConfigurations() const
+    {
+        return configurationRepository->snapshot();
+    }
+    // Frames of the active camera
+    FrameMailbox *getFrameMailbox() { return activePipeline().frameMailbox(); }
+    int cameraCount() const { return (int) cameras.size(); }
+    int getActiveCamera() const { return activeCamera; }
+    // Negotiated mode of the active camera, may change when it reopens
+    CaptureMode getCaptureMode() { return activePipeline().capture().mode(); }
+    const TrackingStream &getTrackingStream() const { return trackingStream; }
 
 signals:
-    void frameReady(const cv::Mat &frame);
     void pointSelected(const QPointF &point);
     void newConfiguration(const Configuration &config);
     void taskFinished(bool success, const QString &message);
@@ -28,9 +42,16 @@ signals:
     void configurationsUpdated();
     void calibrationUpdated(bool status);
     void frameCaptured(int num);
+    void detectorSettingsUpdated(const DetectorSettings &settings);
+    void detectionStats(double detectMs, int markerCount);
+    void sharpnessStats(double sharpness, int skippedFrames);
+    void activeCameraChanged(int camera);
+    // Calibration images are being removed, capture and calibration are refused
+    void imagesBusy(bool busy);
 
 public slots:
     void onPageChanged(int page);
+    void setActiveCamera(int camera);
     void onCaptureFrame();
     void onStartCalibration();
     void onMarkerSizeChanged(int size);
@@ -40,22 +61,38 @@ public slots:
     void removeConfiguration(const Configuration &config);
     void exportConfiguration(const QString &fileName);
     void selectCalibrationFile(const QString &fileName);
+    void setDetectorSettings(const DetectorSettings &settings);
+    void loadDetectorProfile(const QString &fileName);
+    void saveDetectorProfile(const QString &fileName);
 
 private:
     YamlHandler *yamlHandler;
-    CameraThread *cameraThread;
-    CalibrationThread *calibrationThread;
-    MarkerThread *markerThread;
+    // Devices stay open, page switches only swap the stages
+    std::vector<std::unique_ptr<CameraPipeline>> cameras;
+    // Shown, calibrated and edited from the UI, all calibrated cameras track
+    int activeCamera;
+    bool trackingPage;
+    TrackingStream trackingStream;
+    CalibrationTask *calibrationTask;
+    // File work is queued here, results come back through the event loop
+    IoWorker ioWorker;
+    ConfigurationRepository *configurationRepository;
+    ConfigurationCompactor *compactor;
+    QTimer *compactionTimer;
 
     int frameNumber;
     QString imagesDir;
+    // Camera switches whose images are not removed yet
+    int pendingClears;
 
-    CalibrationParams calibrationParams;
-    bool calibrationStatus;
-    std::string calibrationFileName;
+    DetectorSettings detectorSettings;
 
-    void startThread(QThread *thread);
-    void stopThread(QThread *thread);
+    CameraPipeline &activePipeline() { return *cameras[activeCamera]; }
+    void createCameras();
+    void updateStages();
+    void onConfigurationsChanged();
+    void applyCalibrationParams(
+        int camera, bool loaded, const CalibrationParams &params, const std::string &fileName);
     void ensureDirectoryIsClean(const QString &path);
     void clearDirectory(const QString &path);
     Configuration getCurrentConfiguration(const Configuration &newConfiguration);
@@ -1,6 +1,18 @@
 #include "yamlhandler.h"
+#include "configurationindex.h"
+#include "configurationstore.h"
 #include <QDebug>
 #include <QFile>
+#include <QSaveFile>
+#include <QStringList>
+
+// Keeps the default value when the key is missing, operator>> would reset it
+template<typename T>
+static void readIfPresent(const cv::FileNode &node, T &value)
+{
+    if (!node.empty())
+        node >> value;
+}
 
 YamlHandler::YamlHandler(QObject *parent)
     : QObject(parent)
@@ -29,9 +41,101 @@ bool YamlHandler::saveCalibrationParameters(
     return true;
 }
 
+bool YamlHandler::loadDetectorSettings(const std::string &filename, DetectorSettings &settings)
+{
+    cv::FileStorage fs(filename, cv::FileStorage::READ);
+    if (!fs.isOpened())
+        return false;
+    DetectorSettings loaded;
+    cv::FileNode node = fs["DetectorSettings"];
+    if (node.empty())
+        return false;
+    readIfPresent(node["AdaptiveThreshWinSizeMin"], loaded.adaptiveThreshWinSizeMin);
+    readIfPresent(node["AdaptiveThreshWinSizeMax"], loaded.adaptiveThreshWinSizeMax);
+    readIfPresent(node["AdaptiveThreshWinSizeStep"], loaded.adaptiveThreshWinSizeStep);
+    readIfPresent(node["AdaptiveThreshConstant"], loaded.adaptiveThreshConstant);
+    readIfPresent(node["MinMarkerPerimeterRate"], loaded.minMarkerPerimeterRate);
+    readIfPresent(node["MaxMarkerPerimeterRate"], loaded.maxMarkerPerimeterRate);
+    readIfPresent(node["CornerRefinementMethod"], loaded.cornerRefinementMethod);
+    int useReducedDictionary = loaded.useReducedDictionary;
+    readIfPresent(node["UseReducedDictionary"], useReducedDictionary);
+    loaded.useReducedDictionary = useReducedDictionary != 0;
+    int useFusedThreshold = loaded.useFusedThreshold;
+    readIfPresent(node["UseFusedThreshold"], useFusedThreshold);
+    loaded.useFusedThreshold = useFusedThreshold != 0;
+    readIfPresent(node["DetectionWorkers"], loaded.detectionWorkers);
+    readIfPresent(node["TileMarkerSize"], loaded.tileMarkerSize);
+    readIfPresent(node["MinSharpness"], loaded.minSharpness);
+    fs.release();
+    settings = loaded;
+    return true;
+}
+
+bool YamlHandler::saveDetectorSettings(const std::string &filename, const DetectorSettings &settings)
+{
+    cv::FileStorage fs(filename, cv::FileStorage::WRITE);
+    if (!fs.isOpened())
+        return false;
+    fs << "DetectorSettings"
+       << "{";
+    fs << "AdaptiveThreshWinSizeMin" << settings.adaptiveThreshWinSizeMin;
+    fs << "AdaptiveThreshWinSizeMax" << settings.adaptiveThreshWinSizeMax;
+    fs << "AdaptiveThreshWinSizeStep" << settings.adaptiveThreshWinSizeStep;
+    fs << "AdaptiveThreshConstant" << settings.adaptiveThreshConstant;
+    fs << "MinMarkerPerimeterRate" << settings.minMarkerPerimeterRate;
+    fs << "MaxMarkerPerimeterRate" << settings.maxMarkerPerimeterRate;
+    fs << "CornerRefinementMethod" << settings.cornerRefinementMethod;
+    fs << "UseReducedDictionary" << (int) settings.useReducedDictionary;
+    fs << "UseFusedThreshold" << (int) settings.useFusedThreshold;
+    fs << "DetectionWorkers" << settings.detectionWorkers;
+    fs << "TileMarkerSize" << settings.tileMarkerSize;
+    fs << "MinSharpness" << settings.minSharpness;
+    fs << "}";
+    fs.release();
+    return true;
+}
+
+bool YamlHandler::loadCameraSettings(
+    const std::string &filename, std::vector<CameraSettings> &cameras)
+{
+    cv::FileStorage fs(filename, cv::FileStorage::READ);
+    if (!fs.isOpened())
+        return false;
+    cv::FileNode node = fs["Cameras"];
+    if (!node.isSeq() || node.size() == 0)
+        return false;
+
+    std::vector<CameraSettings> loaded;
+    for (const cv::FileNode &cameraNode : node) {
+        CameraSettings camera;
+        camera.device = (int) loaded.size();
+        // The first camera keeps the file of single camera stations
+        if (!loaded.empty())
+            camera.calibrationFile = "calibration_" + std::to_string(loaded.size()) + ".yml";
+        readIfPresent(cameraNode["Device"], camera.device);
+        readIfPresent(cameraNode["Calibration"], camera.calibrationFile);
+        readIfPresent(cameraNode["Width"], camera.processingSize.width);
+        readIfPresent(cameraNode["Height"], camera.processingSize.height);
+        readIfPresent(cameraNode["Fps"], camera.fps);
+        loaded.push_back(camera);
+    }
+    fs.release();
+    cameras = loaded;
+    return true;
+}
+
 bool YamlHandler::loadConfigurations(
     const std::string &filename, std::map<std::string, Configuration> &configurations)
 {
+    if (ConfigurationStore::isStoreFile(filename)) {
+        ConfigurationStore store;
+        if (!QFile::exists(QString::fromStdString(filename))
+            || !store.open(QString::fromStdString(filename)))
+            return false;
+        store.load(configurations);
+        return true;
+    }
+
     try {
         cv::FileStorage fs(filename, cv::FileStorage::READ);
         if (!fs.isOpened())
@@ -69,9 +173,15 @@ bool YamlHandler::loadConfigurations(
 bool YamlHandler::saveConfigurations(
     const std::string &filename, const std::map<std::string, Configuration> &configurations)
 {
-    QFile::remove(QString::fromStdString(filename));
+    if (ConfigurationStore::isStoreFile(filename)) {
+        ConfigurationStore store;
+        store.setFileName(QString::fromStdString(filename));
+        return store.rewrite(configurations);
+    }
 
-    cv::FileStorage fs(filename, cv::FileStorage::WRITE);
+    // Serialized in memory and swapped in atomically, a crash never leaves a
+    // half written library behind
+    cv::FileStorage fs(".yml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
     if (!fs.isOpened())
         return false;
 
@@ -98,27 +208,32 @@ bool YamlHandler::saveConfigurations(
         fs << "}";
     }
     fs << "]";
-    fs.release();
-    return true;
+    std::string contents = fs.releaseAndGetString();
+
+    QSaveFile file(QString::fromStdString(filename));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(contents.data(), (qint64) contents.size());
+    return file.commit();
 }
 
 bool YamlHandler::updateConfigurations(
-    const std::string &filename, const Configuration &currentConfiguration)
+    const std::string &filename,
+    const std::map<std::string, Configuration> &existingConfigurations,
+    const ConfigurationIndex &index,
+    const Configuration &currentConfiguration)
 {
-    std::map<std::string, Configuration> existingConfigurations;
-    loadConfigurations(filename, existingConfigurations);
-
     std::string duplicateName;
     ConflictType conflict
-        = findDuplicateConfiguration(existingConfigurations, currentConfiguration, duplicateName);
+        = index.findConflict(existingConfigurations, currentConfiguration, duplicateName);
 
+    std::vector<std::string> removedNames;
     switch (conflict) {
     case ConflictType::None:
-        existingConfigurations.insert(
-            std::make_pair(currentConfiguration.name, currentConfiguration));
         break;
     case ConflictType::ExactMatch:
-        existingConfigurations[duplicateName] = currentConfiguration;
+        if (duplicateName != currentConfiguration.name)
+            removedNames.push_back(duplicateName);
         break;
     case ConflictType::Intersection:
         emit taskFinished(
@@ -128,7 +243,7 @@ bool YamlHandler::updateConfigurations(
         return false;
     }
 
-    if (!saveConfigurations(filename, existingConfigurations)) {
+    if (!writeChanges(filename, existingConfigurations, {currentConfiguration}, removedNames)) {
         emit taskFinished(false, tr("Не удалось сохранить файл конфигураций!"));
         return false;
     }
@@ -138,20 +253,16 @@ bool YamlHandler::updateConfigurations(
 }
 
 bool YamlHandler::removeConfiguration(
-    const std::string &filename, const Configuration &configToRemove)
+    const std::string &filename,
+    const std::map<std::string, Configuration> &existingConfigurations,
+    const Configuration &configToRemove)
 {
-    std::map<std::string, Configuration> existingConfigurations;
-    loadConfigurations(filename, existingConfigurations);
-
-    auto it = existingConfigurations.find(configToRemove.name);
-    if (it == existingConfigurations.end()) {
+    if (existingConfigurations.find(configToRemove.name) == existingConfigurations.end()) {
         emit taskFinished(false, tr("Конфигурация не найдена для удаления!"));
         return false;
     }
 
-    existingConfigurations.erase(it);
-
-    if (!saveConfigurations(filename, existingConfigurations)) {
+    if (!writeChanges(filename, existingConfigurations, {}, {configToRemove.name})) {
         emit taskFinished(false, tr("Не удалось сохранить файл конфигураций!"));
         return false;
     }
@@ -160,64 +271,86 @@ bool YamlHandler::removeConfiguration(
     return true;
 }
 
-ConflictType YamlHandler::findDuplicateConfiguration(
-    const std::map<std::string, Configuration> &configurations,
-    const Configuration &currentConfiguration,
-    std::string &duplicateName)
+bool YamlHandler::importConfigurations(
+    const std::string &filename,
+    const std::map<std::string, Configuration> &existingConfigurations,
+    const ConfigurationIndex &index,
+    const std::map<std::string, Configuration> &incomingConfigurations,
+    ImportReport &report)
 {
-    bool nameMatches = false;
-    bool markerIdMatches = false;
-    std::string nameMatchConfig;
-    std::string markerIdMatchConfig;
-
-    for (const auto &entry : configurations) {
-        // Проверяем имена
-        if (entry.second.name == currentConfiguration.name) {
-            nameMatches = true;
-            nameMatchConfig = entry.first;
+    // Blocks accepted earlier in the batch take part in the checks of later ones
+    std::map<std::string, Configuration> configurations(existingConfigurations);
+    ConfigurationIndex batchIndex(index);
+    std::vector<Configuration> changed;
+    std::vector<std::string> removedNames;
+    for (const auto &entry : incomingConfigurations) {
+        const Configuration &config = entry.second;
+        std::string duplicateName;
+        switch (batchIndex.findConflict(configurations, config, duplicateName)) {
+        case ConflictType::None:
+            configurations.insert(std::make_pair(config.name, config));
+            batchIndex.insert(config);
+            changed.push_back(config);
+            report.added++;
+            break;
+        case ConflictType::ExactMatch:
+            batchIndex.erase(configurations[duplicateName]);
+            configurations.erase(duplicateName);
+            configurations[config.name] = config;
+            batchIndex.insert(config);
+            changed.push_back(config);
+            if (duplicateName != config.name)
+                removedNames.push_back(duplicateName);
+            report.replaced++;
+            break;
+        case ConflictType::Intersection:
+            report.conflicts.push_back(config.name);
+            break;
         }
+    }
 
-        // Конвертируем в адекватный формат
-        std::vector<int> sortedExistingMarkerIds(entry.second.markerIds);
-        std::vector<int> sortedCurrentMarkerIds(currentConfiguration.markerIds);
-
-        std::sort(sortedExistingMarkerIds.begin(), sortedExistingMarkerIds.end());
-        std::sort(sortedCurrentMarkerIds.begin(), sortedCurrentMarkerIds.end());
-
-        // Проверяем маркеры
-        if (sortedExistingMarkerIds == sortedCurrentMarkerIds) {
-            markerIdMatches = true;
-            markerIdMatchConfig = entry.first;
-        }
+    if (!changed.empty() && !writeChanges(filename, existingConfigurations, changed, removedNames)) {
+        emit taskFinished(false, tr("Не удалось сохранить файл конфигураций!"));
+        return false;
+    }
 
-        // Ищем пересечения
-        std::vector<int> intersection;
-        std::set_intersection(
-            sortedExistingMarkerIds.begin(),
-            sortedExistingMarkerIds.end(),
-            sortedCurrentMarkerIds.begin(),
-            sortedCurrentMarkerIds.end(),
-            std::back_inserter(intersection));
-
-        // Проверяем результат
-        if (!intersection.empty() && intersection.size() != sortedExistingMarkerIds.size()) {
-            duplicateName = "";
-            return ConflictType::Intersection;
+    QString message = tr("Импорт завершен: добавлено %1, обновлено %2.")
+                          .arg(report.added)
+                          .arg(report.replaced);
+    if (!report.conflicts.empty()) {
+        QStringList names;
+        for (const std::string &name : report.conflicts) {
+            names << QString::fromStdString(name);
         }
+        message += "\n"
+                   + tr("Пропущено из-за пересечения маркеров (%1): %2")
+                         .arg(report.conflicts.size())
+                         .arg(names.join(", "));
     }
+    emit taskFinished(report.conflicts.empty(), message);
+    return true;
+}
 
-    if (nameMatches && !markerIdMatches) {
-        duplicateName = nameMatchConfig;
-        return ConflictType::ExactMatch;
-    } else if (!nameMatches && markerIdMatches) {
-        duplicateName = markerIdMatchConfig;
-        return ConflictType::ExactMatch;
-    } else if (nameMatches && markerIdMatches && nameMatchConfig == markerIdMatchConfig) {
-        duplicateName = nameMatchConfig;
-        return ConflictType::ExactMatch;
-    } else if (nameMatches && markerIdMatches && nameMatchConfig != markerIdMatchConfig) {
-        return ConflictType::Intersection;
+// The binary store only needs the changed blocks appended, YAML files are
+// rewritten as a whole
+bool YamlHandler::writeChanges(
+    const std::string &filename,
+    const std::map<std::string, Configuration> &existingConfigurations,
+    const std::vector<Configuration> &changed,
+    const std::vector<std::string> &removedNames)
+{
+    if (ConfigurationStore::isStoreFile(filename)) {
+        ConfigurationStore store;
+        store.setFileName(QString::fromStdString(filename));
+        return store.append(changed, removedNames);
     }
 
-    return ConflictType::None;
+    std::map<std::string, Configuration> configurations(existingConfigurations);
+    for (const std::string &name : removedNames) {
+        configurations.erase(name);
+    }
+    for (const Configuration &config : changed) {
+        configurations[config.name] = config;
+    }
+    return saveConfigurations(filename, configurations);
 }
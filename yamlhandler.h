@@ -1,6 +1,7 @@
 #ifndef YAMLHANDLER_H
 #define YAMLHANDLER_H
 
+#include <opencv2/aruco.hpp>
 #include <opencv2/opencv.hpp>
 #include <QObject>
 
@@ -22,6 +23,13 @@ struct Configuration
         markerIds.clear();
         relativePoints.clear();
     }
+
+    bool operator==(const Configuration &other) const
+    {
+        return id == other.id && name == other.name && type == other.type && date == other.date
+               && markerIds == other.markerIds && relativePoints == other.relativePoints;
+    }
+    bool operator!=(const Configuration &other) const { return !(*this == other); }
 };
 
 struct CalibrationParams
@@ -30,8 +38,74 @@ struct CalibrationParams
     cv::Mat distCoeffs;
 };
 
+// ArUco detector parameters that dominate detection cost, tunable at runtime
+struct DetectorSettings
+{
+    int adaptiveThreshWinSizeMin = 3;
+    int adaptiveThreshWinSizeMax = 23;
+    int adaptiveThreshWinSizeStep = 10;
+    double adaptiveThreshConstant = 7.0;
+    double minMarkerPerimeterRate = 0.03;
+    double maxMarkerPerimeterRate = 4.0;
+    int cornerRefinementMethod = cv::aruco::CORNER_REFINE_NONE;
+    // Detect only the marker ids used by known blocks
+    bool useReducedDictionary = false;
+    // Threshold all window sizes in one pass with FusedMarkerDetector
+    bool useFusedThreshold = false;
+    // Consecutive frames detected at once, more hide detection time behind
+    // the frame interval at the cost of one frame of latency each
+    int detectionWorkers = 1;
+    // Side of the largest expected marker in pixels. Above zero large frames
+    // are split into overlapping tiles that are detected in parallel
+    int tileMarkerSize = 0;
+    // Frames with a lower CameraFrame::sharpness() are neither detected nor
+    // captured for calibration, zero lets every frame through
+    double minSharpness = 0.0;
+
+    cv::aruco::DetectorParameters toDetectorParameters() const
+    {
+        cv::aruco::DetectorParameters params;
+        params.adaptiveThreshWinSizeMin = std::max(3, adaptiveThreshWinSizeMin);
+        params.adaptiveThreshWinSizeMax = std::max(
+            params.adaptiveThreshWinSizeMin, adaptiveThreshWinSizeMax);
+        params.adaptiveThreshWinSizeStep = std::max(1, adaptiveThreshWinSizeStep);
+        params.adaptiveThreshConstant = adaptiveThreshConstant;
+        params.minMarkerPerimeterRate = minMarkerPerimeterRate;
+        params.maxMarkerPerimeterRate = std::max(minMarkerPerimeterRate, maxMarkerPerimeterRate);
+        params.cornerRefinementMethod = cornerRefinementMethod;
+        return params;
+    }
+};
+
+// One camera of the station, cameras.yml lists them in order
+struct CameraSettings
+{
+    int device = 0;
+    std::string calibrationFile = "calibration.yml";
+    // Size detection and calibration work at, the device is asked for it
+    cv::Size processingSize = cv::Size(640, 480);
+    double fps = 30.0;
+};
+
+const std::string CAMERAS_FILE = "cameras.yml";
+
+// Working block library. YAML files are kept for import, export and for
+// migrating libraries created before the binary store
+const std::string CONFIGURATIONS_FILE = "configurations.bin";
+const std::string LEGACY_CONFIGURATIONS_FILE = "configurations.yml";
+
 enum class ConflictType { None, ExactMatch, Intersection };
 
+class ConfigurationIndex;
+
+// Outcome of a batch import, rejected blocks are listed by name
+struct ImportReport
+{
+    int added = 0;
+    int replaced = 0;
+    std::vector<std::string> conflicts;
+};
+
 class YamlHandler : public QObject
 {
     Q_OBJECT
@@ -41,21 +115,40 @@ public:
     bool loadCalibrationParameters(const std::string &filename, CalibrationParams &params);
     bool saveCalibrationParameters(
         const std::string &filename, const cv::Mat &cameraMatrix, const cv::Mat &distCoeffs);
+    bool loadDetectorSettings(const std::string &filename, DetectorSettings &settings);
+    bool saveDetectorSettings(const std::string &filename, const DetectorSettings &settings);
+    bool loadCameraSettings(const std::string &filename, std::vector<CameraSettings> &cameras);
     bool loadConfigurations(
         const std::string &filename, std::map<std::string, Configuration> &configurations);
     bool saveConfigurations(
         const std::string &filename, const std::map<std::string, Configuration> &configurations);
-    bool updateConfigurations(const std::string &filename, const Configuration &currentConfiguration);
-    bool removeConfiguration(const std::string &filename, const Configuration &configToRemove);
+    // The edits below check against the library already in memory and only
+    // write the changes, callers pick them up from the file afterwards
+    bool updateConfigurations(
+        const std::string &filename,
+        const std::map<std::string, Configuration> &existingConfigurations,
+        const ConfigurationIndex &index,
+        const Configuration &currentConfiguration);
+    bool removeConfiguration(
+        const std::string &filename,
+        const std::map<std::string, Configuration> &existingConfigurations,
+        const Configuration &configToRemove);
+    bool importConfigurations(
+        const std::string &filename,
+        const std::map<std::string, Configuration> &existingConfigurations,
+        const ConfigurationIndex &index,
+        const std::map<std::string, Configuration> &incomingConfigurations,
+        ImportReport &report);
 
 signals:
     void taskFinished(bool success, const QString &message);
 
 private:
-    ConflictType findDuplicateConfiguration(
-        const std::map<std::string, Configuration> &configurations,
-        const Configuration &currentConfiguration,
-        std::string &duplicateName);
+    bool writeChanges(
+        const std::string &filename,
+        const std::map<std::string, Configuration> &existingConfigurations,
+        const std::vector<Configuration> &changed,
+        const std::vector<std::string> &removedNames);
 };
 
 #endif // YAMLHANDLER_H